@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hashWord.h"
+#include "qsortHTEntriesExt.h"
+#include "approx.h"
+
+#define AP_EMPTY (-1)
+#define AP_MAX_DEPTH 64
+
+typedef struct
+{
+   HTEntry64 entry;        /* first, so compareHTEntries64 sorts ApItems */
+   uint64_t error;
+} ApItem;
+
+static void* ap_alloc(size_t count, size_t size)
+{
+   void *ptr = calloc(count, size);
+
+   if (ptr == NULL && count > 0)
+   {
+      perror("wf");
+      exit(EXIT_FAILURE);
+   }
+   return ptr;
+}
+
+ApproxCount* apCreate(double epsilon, double delta, unsigned k)
+{
+   ApproxCount *ap = ap_alloc(1, sizeof(ApproxCount));
+   unsigned indexSize = 1, i;
+
+   if (epsilon < AP_MIN_EPSILON)
+      epsilon = AP_MIN_EPSILON;
+   ap -> width = (unsigned)ceil(M_E / epsilon);
+   ap -> depth = (unsigned)ceil(log(1 / delta));
+   ap -> depth = ap -> depth < 1 ? 1 : min(ap -> depth, AP_MAX_DEPTH);
+   ap -> sketch = ap_alloc((size_t)ap -> width * ap -> depth, sizeof(uint64_t));
+   ap -> capacity = (unsigned)ceil(1 / epsilon);
+   if (ap -> capacity < k)
+      ap -> capacity = min(k, AP_MAX_CAPACITY);
+   ap -> slots = ap_alloc(ap -> capacity, sizeof(ApSlot));
+   ap -> heap = ap_alloc(ap -> capacity, sizeof(unsigned));
+   while (indexSize < 2 * ap -> capacity)
+      indexSize *= 2;
+   ap -> index = ap_alloc(indexSize, sizeof(int));
+   for (i = 0; i < indexSize; i++)
+      ap -> index[i] = AP_EMPTY;
+   ap -> indexMask = indexSize - 1;
+   ap -> unique = hllCreate();
+   return ap;
+}
+
+/*
+ * Conservative update: the word's estimate becomes its smallest counter
+ * plus count, and only counters below that are raised to it. Returns the
+ * new estimate.
+ */
+static uint64_t ap_sketch(ApproxCount *ap, unsigned long long hash, \
+   uint64_t count)
+{
+   uint64_t h1 = hash & 0xFFFFFFFF, h2 = (hash >> 32) | 1, estimate = 0;
+   uint64_t *counter[AP_MAX_DEPTH];
+   unsigned i;
+
+   for (i = 0; i < ap -> depth; i++)
+   {
+      counter[i] = &ap -> sketch[(size_t)i * ap -> width + \
+         (h1 + i * h2) % ap -> width];
+      if (i == 0 || *counter[i] < estimate)
+         estimate = *counter[i];
+   }
+   estimate += count;
+   for (i = 0; i < ap -> depth; i++)
+   {
+      if (*counter[i] < estimate)
+         *counter[i] = estimate;
+   }
+   return estimate;
+}
+
+static unsigned ap_home(ApproxCount *ap, unsigned long long hash)
+{
+   return (unsigned)(hash ^ (hash >> 29)) & ap -> indexMask;
+}
+
+/*
+ * Returns the index position holding word, or the empty one where it goes.
+ */
+static unsigned ap_find(ApproxCount *ap, const Word *word, \
+   unsigned long long hash)
+{
+   unsigned i = ap_home(ap, hash);
+   ApSlot *slot;
+
+   while (ap -> index[i] != AP_EMPTY)
+   {
+      slot = &ap -> slots[ap -> index[i]];
+      if (slot -> hash == hash && slot -> word.length == word -> length && \
+         memcmp(slot -> word.bytes, word -> bytes, word -> length) == 0)
+         break;
+      i = (i + 1) & ap -> indexMask;
+   }
+   return i;
+}
+
+/*
+ * Empties index position i, shifting back the entries probed past it.
+ */
+static void ap_unindex(ApproxCount *ap, unsigned i)
+{
+   unsigned j = i, home;
+
+   for (;;)
+   {
+      j = (j + 1) & ap -> indexMask;
+      if (ap -> index[j] == AP_EMPTY)
+         break;
+      home = ap_home(ap, ap -> slots[ap -> index[j]].hash);
+      /* Move the entry at j unless its home lies cyclically in (i, j] */
+      if (((j - home) & ap -> indexMask) >= ((j - i) & ap -> indexMask))
+      {
+         ap -> index[i] = ap -> index[j];
+         i = j;
+      }
+   }
+   ap -> index[i] = AP_EMPTY;
+}
+
+static void ap_heap_set(ApproxCount *ap, unsigned i, unsigned s)
+{
+   ap -> heap[i] = s;
+   ap -> slots[s].heap = i;
+}
+
+/*
+ * Restores the heap after the count of the slot at heap position i changed.
+ */
+static void ap_sift(ApproxCount *ap, unsigned i)
+{
+   unsigned s = ap -> heap[i], parent, child;
+   uint64_t count = ap -> slots[s].count;
+
+   while (i > 0 && ap -> slots[ap -> heap[parent = (i - 1) / 2]].count > count)
+   {
+      ap_heap_set(ap, i, ap -> heap[parent]);
+      i = parent;
+   }
+   while ((child = 2 * i + 1) < ap -> used)
+   {
+      if (child + 1 < ap -> used && ap -> slots[ap -> heap[child + 1]].count \
+         < ap -> slots[ap -> heap[child]].count)
+         child++;
+      if (ap -> slots[ap -> heap[child]].count >= count)
+         break;
+      ap_heap_set(ap, i, ap -> heap[child]);
+      i = child;
+   }
+   ap_heap_set(ap, i, s);
+}
+
+static void ap_set_word(ApSlot *slot, const Word *word, \
+   unsigned long long hash)
+{
+   if (slot -> size < word -> length)
+   {
+      slot -> size = word -> length > 2 * slot -> size ? word -> length : \
+         2 * slot -> size;
+      free(slot -> word.bytes);
+      slot -> word.bytes = ap_alloc(slot -> size, sizeof(Byte));
+   }
+   memcpy(slot -> word.bytes, word -> bytes, word -> length);
+   slot -> word.length = word -> length;
+   slot -> hash = hash;
+}
+
+void apAdd(ApproxCount *ap, const Word *word, uint64_t count)
+{
+   unsigned long long hash = hashWord64(word);
+   uint64_t estimate, lower;
+   unsigned i = ap_find(ap, word, hash), s;
+   ApSlot *slot;
+
+   ap -> total += count;
+   hllAdd(ap -> unique, hash);
+   estimate = ap_sketch(ap, hash, count);
+   if (ap -> index[i] != AP_EMPTY)
+   {
+      /* Both are upper bounds, keep the tighter one */
+      slot = &ap -> slots[ap -> index[i]];
+      lower = slot -> count - slot -> error + count;
+      slot -> count = min(slot -> count + count, estimate);
+      slot -> error = slot -> count - lower;
+      ap_sift(ap, slot -> heap);
+      return;
+   }
+   if (ap -> used < ap -> capacity)
+   {
+      /* Nothing was ever evicted, so the word is new */
+      s = (ap -> used)++;
+      slot = &ap -> slots[s];
+      slot -> count = count;
+      slot -> error = 0;
+      ap_heap_set(ap, s, s);
+   }
+   else
+   {
+      s = ap -> heap[0];
+      slot = &ap -> slots[s];
+      ap_unindex(ap, ap_find(ap, &slot -> word, slot -> hash));
+      i = ap_find(ap, word, hash);
+      slot -> count = min(slot -> count + count, estimate);
+      slot -> error = slot -> count - count;
+   }
+   ap_set_word(slot, word, hash);
+   ap -> index[i] = s;
+   ap_sift(ap, slot -> heap);
+}
+
+uint64_t apUnique(ApproxCount *ap)
+{
+   return hllEstimate(ap -> unique);
+}
+
+uint64_t apTotal(ApproxCount *ap)
+{
+   return ap -> total;
+}
+
+HTEntry64* apTop(ApproxCount *ap, unsigned k, uint64_t **errors, \
+   uint64_t *size)
+{
+   ApItem *items = ap_alloc(ap -> used, sizeof(ApItem));
+   HTEntry64 *entries;
+   unsigned i;
+
+   for (i = 0; i < ap -> used; i++)
+   {
+      items[i].entry.data = &ap -> slots[i].word;
+      items[i].entry.frequency = ap -> slots[i].count;
+      items[i].error = ap -> slots[i].error;
+   }
+   qsort(items, ap -> used, sizeof(ApItem), compareHTEntries64);
+   *size = min(k, ap -> used);
+   entries = *size > 0 ? ap_alloc(*size, sizeof(HTEntry64)) : NULL;
+   *errors = *size > 0 ? ap_alloc(*size, sizeof(uint64_t)) : NULL;
+   for (i = 0; i < *size; i++)
+   {
+      entries[i] = items[i].entry;
+      (*errors)[i] = items[i].error;
+   }
+   free(items);
+   return entries;
+}
+
+void apDestroy(ApproxCount *ap)
+{
+   unsigned i;
+
+   for (i = 0; i < ap -> used; i++)
+      free(ap -> slots[i].word.bytes);
+   free(ap -> sketch);
+   free(ap -> slots);
+   free(ap -> heap);
+   free(ap -> index);
+   hllDestroy(ap -> unique);
+   free(ap);
+}
@@ -0,0 +1,87 @@
+#ifndef APPROX_H
+#define APPROX_H
+
+/*
+ * Approximate heavy hitters for wf -aEPSILON,DELTA, in memory that depends
+ * on EPSILON, DELTA and -n but not on the number of unique words.
+ *
+ *    Count-Min sketch: DEPTH = ceil(ln(1 / DELTA)) rows of WIDTH =
+ *       ceil(e / EPSILON) counters, updated conservatively (only counters
+ *       below the new estimate are raised). Its estimate of a word never
+ *       undercounts, and overcounts by more than EPSILON * N (N the total
+ *       word count) with probability at most DELTA.
+ *    Space-Saving summary: the CAPACITY = max(ceil(1 / EPSILON), -n) words
+ *       currently thought most frequent, with a count and an error. A word
+ *       that is not in a full summary replaces the one with the smallest
+ *       count and starts from the smaller of that count and the sketch's
+ *       estimate. A word's true count is always in [count - error, count],
+ *       and error is at most N / CAPACITY.
+ *    HyperLogLog (see hll.h): estimates the number of unique words with a
+ *       standard error of about 1.04 / sqrt(2^HLL_BITS).
+ */
+#include <stdint.h>
+#include "getWord.h"
+#include "hashTable64.h"
+#include "hll.h"
+
+/*
+ * The smallest EPSILON: a sketch row of ceil(e / EPSILON) counters and a
+ * summary of ceil(1 / EPSILON) words are still allocated in one go.
+ */
+#define AP_MIN_EPSILON 1e-6
+#define AP_MAX_CAPACITY (1U << 24)
+
+typedef struct
+{
+   Word word;              /* bytes point to a buffer owned by the slot */
+   unsigned size;          /* of that buffer */
+   unsigned long long hash;
+   uint64_t count, error;
+   unsigned heap;          /* position in the heap */
+} ApSlot;
+
+typedef struct
+{
+   uint64_t *sketch;       /* depth rows of width counters */
+   unsigned width, depth;
+   ApSlot *slots;          /* the summary */
+   unsigned capacity, used;
+   unsigned *heap;         /* slot indexes, smallest count first */
+   int *index;             /* slot by hash, linear probing, -1 empty */
+   unsigned indexMask;
+   HyperLogLog *unique;
+   uint64_t total;
+} ApproxCount;
+
+/* Description: Creates an empty count, epsilon and delta in (0, 1), for a
+ *    ranking of at least k words. Exits with a message when out of memory.
+ *
+ * Notes: epsilon below AP_MIN_EPSILON sizes the count as AP_MIN_EPSILON,
+ *    and the summary holds at most AP_MAX_CAPACITY words whatever k.
+ */
+ApproxCount* apCreate(double epsilon, double delta, unsigned k);
+
+/* Description: Counts count occurrences of word, which is only borrowed.
+ */
+void apAdd(ApproxCount *ap, const Word *word, uint64_t count);
+
+/* Description: Returns the HyperLogLog estimate of the number of unique
+ *    words and the exact number of words.
+ */
+uint64_t apUnique(ApproxCount *ap);
+uint64_t apTotal(ApproxCount *ap);
+
+/* Description: Returns the first k words of the summary in
+ *    compareHTEntries64 order of their counts, and sets errors to a
+ *    parallel array with the error of each count. The words stay valid
+ *    until apDestroy.
+ *
+ * Return: A dynamically allocated array (NULL when empty) the caller frees,
+ *    like errors, size is set to its length.
+ */
+HTEntry64* apTop(ApproxCount *ap, unsigned k, uint64_t **errors, \
+   uint64_t *size);
+
+void apDestroy(ApproxCount *ap);
+
+#endif
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/* Slab headers are padded so slab memory keeps ARENA_ALIGN alignment */
+#define SLAB_HEADER ((sizeof(Slab) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static Slab* arena_slab(Arena *arena, size_t size)
+{
+   Slab *slab = malloc(SLAB_HEADER + size);
+
+   if (slab == NULL)
+   {
+      perror("arena");
+      exit(EXIT_FAILURE);
+   }
+   slab -> used = 0;
+   slab -> size = size;
+   arena -> reserved += SLAB_HEADER + size;
+   return slab;
+}
+
+Arena* arenaCreate(size_t slabSize)
+{
+   Arena *arena = malloc(sizeof(Arena));
+
+   if (arena == NULL)
+   {
+      perror("arena");
+      exit(EXIT_FAILURE);
+   }
+   arena -> head = NULL;
+   arena -> slabSize = slabSize > 0 ? slabSize : ARENA_SLAB_SIZE;
+   arena -> allocated = arena -> reserved = 0;
+   return arena;
+}
+
+void* arenaAlloc(Arena *arena, size_t size)
+{
+   Slab *slab = arena -> head;
+
+   size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+   arena -> allocated += size;
+   if (size > arena -> slabSize / 4)
+   {
+      /* Oversized: private slab linked behind the current one */
+      slab = arena_slab(arena, size);
+      slab -> used = size;
+      slab -> next = arena -> head != NULL ? arena -> head -> next : NULL;
+      if (arena -> head != NULL)
+         arena -> head -> next = slab;
+      else
+         arena -> head = slab;
+      return (char*)slab + SLAB_HEADER;
+   }
+   if (slab == NULL || slab -> size - slab -> used < size)
+   {
+      slab = arena_slab(arena, arena -> slabSize);
+      slab -> next = arena -> head;
+      arena -> head = slab;
+   }
+   slab -> used += size;
+   return (char*)slab + SLAB_HEADER + slab -> used - size;
+}
+
+void arenaDestroy(Arena *arena)
+{
+   Slab *slab = arena -> head, *next;
+
+   while (slab != NULL)
+   {
+      next = slab -> next;
+      free(slab);
+      slab = next;
+   }
+   free(arena);
+}
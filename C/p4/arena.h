@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * Bump allocator. Memory is carved from large slabs and only ever released
+ * all at once by arenaDestroy, so allocating is a pointer bump and tearing
+ * down millions of small objects is one free per slab.
+ */
+#include <stddef.h>
+
+#define ARENA_SLAB_SIZE (1 << 20)
+#define ARENA_ALIGN sizeof(void*)
+
+typedef struct slab
+{
+   struct slab *next;
+   size_t used, size;
+} Slab;
+
+typedef struct
+{
+   Slab *head;          /* slab currently being carved */
+   size_t slabSize;
+   size_t allocated;    /* bytes handed out, for statistics */
+   size_t reserved;     /* bytes obtained from malloc */
+} Arena;
+
+/* Description: Creates an empty arena whose slabs are slabSize bytes (0 for
+ *    ARENA_SLAB_SIZE). Requests larger than a quarter slab get a slab of
+ *    their own so they do not waste the rest of the current one.
+ */
+Arena* arenaCreate(size_t slabSize);
+
+/* Description: Returns size bytes aligned to ARENA_ALIGN. Never returns NULL,
+ *    exits with a message when out of memory.
+ */
+void* arenaAlloc(Arena *arena, size_t size);
+
+/* Description: Frees every slab and the arena itself.
+ */
+void arenaDestroy(Arena *arena);
+
+#endif
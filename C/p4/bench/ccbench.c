@@ -0,0 +1,307 @@
+/*
+ * Scaling benchmark and stress test of the HT_CONCURRENT engine. The words
+ * of a corpus are read once into memory, then counted into one shared
+ * HT_CONCURRENT table by 1, 2, 4, ... up to -tMAX threads, each interning
+ * an equal slice of them at the same time. Every count is checked against a
+ * serial table of the same words: any lost or extra occurrence, or a word
+ * missing from or added to the table, fails the run.
+ *
+ * Each thread count is written as one JSON object on a line of its own,
+ * with its fastest time of -rRUNS runs and its speedup over one thread.
+ * The collide corpus of gencorpus has few words per segment and long
+ * chains, so it stresses the locks; zipf shows the scaling of text.
+ *
+ * Usage: ccbench [-tMAX] [-rRUNS] [-cLABEL] [-eENGINE] corpus
+ *    ENGINE: chain (default) or open, the engine of the segments
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../getWord.h"
+#include "../hashTable.h"
+#include "../hashTable64.h"
+#include "../hashWord.h"
+#include "../wordSource.h"
+#include "../output.h"
+#include "../main.h"
+
+#define CB_MAX_THREADS 256
+
+/*
+ * The words of the corpus: word i is bytes[ends[i - 1], ends[i]).
+ */
+typedef struct
+{
+   Byte *bytes;
+   uint32_t *ends;
+   uint64_t count, size;
+} CBWords;
+
+typedef struct
+{
+   pthread_t thread;
+   CBWords *words;
+   void *ht;
+   uint64_t begin, end;
+} CBWorker;
+
+static double cb_now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void cb_usage(void)
+{
+   fprintf(stderr, "Usage: ccbench [-tMAX] [-rRUNS] [-cLABEL] [-eENGINE]");
+   fprintf(stderr, " corpus\n");
+   exit(EXIT_FAILURE);
+}
+
+static void* cb_alloc(void *pointer)
+{
+   if (pointer == NULL)
+   {
+      perror("ccbench");
+      exit(EXIT_FAILURE);
+   }
+   return pointer;
+}
+
+/*
+ * FNClone of the HT_OPEN segments, which have no arena: the Word and its
+ * bytes in one malloc, which htDestroy frees.
+ */
+static void* cb_clone(const void *data, void *context)
+{
+   const Word *word = data;
+   Word *copy = cb_alloc(malloc(sizeof(Word) + word -> length));
+
+   copy -> bytes = (Byte*)(copy + 1);
+   copy -> length = word -> length;
+   memcpy(copy -> bytes, word -> bytes, word -> length);
+   return copy;
+}
+
+static Word cb_word(CBWords *words, uint64_t i)
+{
+   Word word;
+   uint32_t begin = i == 0 ? 0 : words -> ends[i - 1];
+
+   word.bytes = words -> bytes + begin;
+   word.length = words -> ends[i] - begin;
+   return word;
+}
+
+static void cb_read(const char *corpus, CBWords *words)
+{
+   WordSource *ws = wsOpenFd(fileOpen(corpus));
+   uint64_t capacity = 1 << 20, bytesCapacity = 1 << 24;
+   Byte *word;
+   unsigned length;
+   int hasPrintable;
+
+   words -> bytes = cb_alloc(malloc(bytesCapacity));
+   words -> ends = cb_alloc(malloc(capacity * sizeof(uint32_t)));
+   while (EOF != wsNextWord(ws, &word, &length, &hasPrintable))
+   {
+      if (hasPrintable != TRUE)
+         continue;
+      if (words -> size + length > UINT32_MAX)
+      {
+         fprintf(stderr, "ccbench: %s: more than 4 GB of words\n", corpus);
+         exit(EXIT_FAILURE);
+      }
+      while (words -> size + length > bytesCapacity)
+         words -> bytes = cb_alloc(realloc(words -> bytes, \
+            bytesCapacity *= 2));
+      if (words -> count == capacity)
+         words -> ends = cb_alloc(realloc(words -> ends, \
+            (capacity *= 2) * sizeof(uint32_t)));
+      memcpy(words -> bytes + words -> size, word, length);
+      words -> size += length;
+      words -> ends[(words -> count)++] = words -> size;
+   }
+   wsClose(ws);
+}
+
+static void* cb_worker(void *arg)
+{
+   CBWorker *worker = arg;
+   Word word;
+   uint64_t i;
+
+   for (i = worker -> begin; i < worker -> end; i++)
+   {
+      word = cb_word(worker -> words, i);
+      htIntern64(worker -> ht, &word, cb_clone, NULL);
+   }
+   return NULL;
+}
+
+/*
+ * Counts the words on threads threads. Returns the seconds taken.
+ */
+static double cb_count(CBWords *words, void *ht, int threads)
+{
+   CBWorker workers[CB_MAX_THREADS];
+   double start = cb_now();
+   int i;
+
+   for (i = 0; i < threads; i++)
+   {
+      workers[i].words = words;
+      workers[i].ht = ht;
+      workers[i].begin = words -> count * i / threads;
+      workers[i].end = words -> count * (i + 1) / threads;
+      if (pthread_create(&workers[i].thread, NULL, cb_worker, &workers[i]))
+         cb_alloc(NULL);
+   }
+   for (i = 0; i < threads; i++)
+      pthread_join(workers[i].thread, NULL);
+   return cb_now() - start;
+}
+
+/*
+ * Every entry of ht must have the count of reference, and the two the same
+ * number of entries and words.
+ */
+static void cb_verify(void *ht, void *reference, int threads)
+{
+   uint64_t size, i;
+   HTEntry64 *entries = htToArray64(ht, &size);
+   HTEntry64 expected;
+
+   if (size != htUniqueEntries64(reference) || \
+      htTotalEntries64(ht) != htTotalEntries64(reference))
+   {
+      fprintf(stderr, "ccbench: %d threads: %llu unique, %llu total words" \
+         " instead of %llu and %llu\n", threads, (unsigned long long)size, \
+         (unsigned long long)htTotalEntries64(ht), \
+         (unsigned long long)htUniqueEntries64(reference), \
+         (unsigned long long)htTotalEntries64(reference));
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < size; i++)
+   {
+      expected = htLookUp64(reference, entries[i].data);
+      if (expected.frequency != entries[i].frequency)
+      {
+         fprintf(stderr, "ccbench: %d threads: \"%.*s\" counted %llu times" \
+            " instead of %llu\n", threads, \
+            ((Word*)entries[i].data) -> length, \
+            ((Word*)entries[i].data) -> bytes, \
+            (unsigned long long)entries[i].frequency, \
+            (unsigned long long)expected.frequency);
+         exit(EXIT_FAILURE);
+      }
+   }
+   free(entries);
+}
+
+static void cb_report(const char *label, const char *corpus, \
+   const char *engine, int threads, double seconds, double one, \
+   uint64_t tokens)
+{
+   Output *out = outOpen(STDOUT_FILENO);
+   char number[64];
+
+   outString(out, "{\"label\":");
+   outJson(out, (const Byte*)label, strlen(label));
+   outString(out, ",\"corpus\":");
+   outJson(out, (const Byte*)corpus, strlen(corpus));
+   outString(out, ",\"engine\":");
+   outJson(out, (const Byte*)engine, strlen(engine));
+   outString(out, ",\"threads\":");
+   outUint(out, threads, 0);
+   outString(out, ",\"tokens\":");
+   outUint(out, tokens, 0);
+   snprintf(number, sizeof(number), ",\"seconds\":%.6f", seconds);
+   outString(out, number);
+   snprintf(number, sizeof(number), ",\"tokensPerSecond\":%.0f", \
+      tokens / seconds);
+   outString(out, number);
+   snprintf(number, sizeof(number), ",\"speedup\":%.3f}\n", one / seconds);
+   outString(out, number);
+   outClose(out);
+}
+
+int main(int argc, char *argv[])
+{
+   Options opts = {INT_MAX, 0, 1, hashWord, hashWord64};
+   const char *label = "", *corpus = NULL, *engine = "chain";
+   CBWords words = {NULL, NULL, 0, 0};
+   double seconds, fastest = 0, one = 0;
+   int maxThreads = 16, runs = 1, threads, run, i;
+   void *reference, *ht;
+   Word word;
+   uint64_t j;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (argv[i][0] != '-')
+         corpus = argv[i];
+      else if (argv[i][1] == 't')
+      {
+         if (sscanf(argv[i], "-t%d", &maxThreads) != 1 || maxThreads < 1 || \
+            maxThreads > CB_MAX_THREADS)
+            cb_usage();
+      }
+      else if (argv[i][1] == 'r')
+      {
+         if (sscanf(argv[i], "-r%d", &runs) != 1 || runs < 1)
+            cb_usage();
+      }
+      else if (argv[i][1] == 'c')
+         label = argv[i] + 2;
+      else if (argv[i][1] == 'e')
+      {
+         engine = argv[i] + 2;
+         check_engine(engine, &opts);
+         if (opts.flags & HT_INCREMENTAL)
+            cb_usage();
+      }
+      else
+         cb_usage();
+   }
+   if (corpus == NULL)
+      cb_usage();
+   cb_read(corpus, &words);
+
+   reference = createTable(&opts);
+   for (j = 0; j < words.count; j++)
+   {
+      word = cb_word(&words, j);
+      htIntern64(reference, &word, cb_clone, NULL);
+   }
+   opts.flags |= HT_CONCURRENT;
+   /* The powers of two below maxThreads, then maxThreads itself */
+   for (threads = 1; threads <= maxThreads; \
+      threads = threads < maxThreads && threads * 2 > maxThreads ? \
+         maxThreads : threads * 2)
+   {
+      for (run = 0; run < runs; run++)
+      {
+         ht = createTable(&opts);
+         seconds = cb_count(&words, ht, threads);
+         cb_verify(ht, reference, threads);
+         htDestroy(ht);
+         if (run == 0 || seconds < fastest)
+            fastest = seconds;
+      }
+      if (threads == 1)
+         one = fastest;
+      cb_report(label, corpus, engine, threads, fastest, one, words.count);
+   }
+   htDestroy(reference);
+   free(words.bytes);
+   free(words.ends);
+   return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * Synthetic corpora for bench/wfbench, written to stdout. The same options
+ * and seed always produce the same bytes.
+ *
+ *    zipf: WORDS words drawn from a vocabulary of UNIQUE words, the word of
+ *       rank r with probability proportional to 1 / r^EXPONENT, like the
+ *       words of natural text.
+ *    uniform: WORDS words that are all different, the worst case for the
+ *       table's memory and for the ranking.
+ *    collide: WORDS words drawn uniformly from UNIQUE words that wf's default
+ *       hash (hashWord64 with its fixed seed) sends to the first 1/SPREAD of
+ *       the buckets of the table size a count of UNIQUE words ends at, so
+ *       chains or probe sequences are about SPREAD times longer than usual.
+ *
+ * The word of a number n is n in bijective base 26, each position spelled
+ * with its own permutation of the letters, so different numbers always give
+ * different words and small numbers (the frequent ranks) short ones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "../getWord.h"
+#include "../hashWord.h"
+#include "../main.h"
+
+#define GC_MAX_WORD 16       /* letters of the largest uint64_t */
+#define GC_LINE_WORDS 12
+
+typedef struct
+{
+   const char *type;         /* -tTYPE */
+   uint64_t words;           /* -wWORDS */
+   uint64_t unique;          /* -uUNIQUE */
+   double exponent;          /* -zEXPONENT */
+   unsigned spread;          /* -kSPREAD */
+   uint64_t seed;            /* -sSEED */
+} GenOptions;
+
+static uint64_t gcState;
+static char gcLetters[GC_MAX_WORD][26];
+
+/*
+ * splitmix64: a bijection of its argument, and a generator when called on
+ * consecutive states.
+ */
+static uint64_t gc_mix(uint64_t x)
+{
+   x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+   return x ^ (x >> 31);
+}
+
+static uint64_t gc_next(void)
+{
+   return gc_mix(gcState += 0x9E3779B97F4A7C15ULL);
+}
+
+/* A double in [0, 1) */
+static double gc_uniform(void)
+{
+   return (gc_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void gc_seed(uint64_t seed)
+{
+   int i, j, k;
+   char c;
+
+   gcState = seed;
+   for (i = 0; i < GC_MAX_WORD; i++)
+   {
+      for (j = 0; j < 26; j++)
+         gcLetters[i][j] = 'a' + j;
+      for (j = 25; j > 0; j--)
+      {
+         k = gc_next() % (j + 1);
+         c = gcLetters[i][j];
+         gcLetters[i][j] = gcLetters[i][k];
+         gcLetters[i][k] = c;
+      }
+   }
+}
+
+/*
+ * Spells n + 1 in bijective base 26. Returns the length.
+ */
+static unsigned gc_word(uint64_t n, Byte *word)
+{
+   unsigned length = 0;
+
+   for (n++; n > 0; n = (n - 1) / 26, length++)
+      word[length] = gcLetters[length][(n - 1) % 26];
+   return length;
+}
+
+static void gc_emit(const Byte *word, unsigned length, uint64_t i)
+{
+   fwrite(word, 1, length, stdout);
+   putchar((i + 1) % GC_LINE_WORDS == 0 ? '\n' : ' ');
+}
+
+static void* gc_alloc(size_t count, size_t size)
+{
+   void *ptr = malloc(count * size);
+
+   if (ptr == NULL)
+   {
+      perror("gencorpus");
+      exit(EXIT_FAILURE);
+   }
+   return ptr;
+}
+
+/*
+ * Inverse transform sampling on the cumulative distribution of the ranks.
+ */
+static void gc_zipf(GenOptions *opts)
+{
+   double *cdf = gc_alloc(opts -> unique, sizeof(double)), sum = 0, u;
+   uint64_t i, r, low, high;
+   Byte word[GC_MAX_WORD];
+
+   for (r = 0; r < opts -> unique; r++)
+      cdf[r] = sum += pow(r + 1, -opts -> exponent);
+   for (i = 0; i < opts -> words; i++)
+   {
+      u = gc_uniform() * sum;
+      for (low = 0, high = opts -> unique - 1; low < high; )
+      {
+         r = low + (high - low) / 2;
+         if (cdf[r] <= u)
+            low = r + 1;
+         else
+            high = r;
+      }
+      gc_emit(word, gc_word(low, word), i);
+   }
+   free(cdf);
+}
+
+/*
+ * gc_mix is a bijection, so every i gives a different number, and the
+ * numbers are in no particular order.
+ */
+static void gc_uniform_words(GenOptions *opts)
+{
+   Byte word[GC_MAX_WORD];
+   uint64_t i;
+
+   for (i = 0; i < opts -> words; i++)
+      gc_emit(word, gc_word(gc_mix(opts -> seed ^ i), word), i);
+}
+
+/*
+ * The first size of createTable that holds unique words without rehashing.
+ */
+static uint64_t gc_final_size(uint64_t unique)
+{
+   uint64_t sizes[] = {WF_TABLE_SIZES};
+   int i, n = sizeof(sizes) / sizeof(uint64_t);
+
+   for (i = 0; i < n - 1 && unique > WF_LOAD_FACTOR * sizes[i]; i++)
+      ;
+   return sizes[i];
+}
+
+static void gc_collide(GenOptions *opts)
+{
+   Byte *words = gc_alloc(opts -> unique, GC_MAX_WORD);
+   unsigned *lengths = gc_alloc(opts -> unique, sizeof(unsigned));
+   uint64_t size = gc_final_size(opts -> unique), n, i, found = 0;
+   uint64_t limit = size / opts -> spread > 0 ? size / opts -> spread : 1;
+   Word candidate;
+
+   candidate.bytes = words;
+   for (n = 0; found < opts -> unique; n++)
+   {
+      candidate.length = gc_word(gc_mix(opts -> seed ^ n), candidate.bytes);
+      if (hashWord64(&candidate) % size < limit)
+      {
+         lengths[found++] = candidate.length;
+         candidate.bytes += GC_MAX_WORD;
+      }
+   }
+   for (i = 0; i < opts -> words; i++)
+   {
+      n = gc_next() % opts -> unique;
+      gc_emit(words + n * GC_MAX_WORD, lengths[n], i);
+   }
+   free(words);
+   free(lengths);
+}
+
+static void gc_usage(void)
+{
+   fprintf(stderr, "Usage: gencorpus -tTYPE [-wWORDS] [-uUNIQUE]");
+   fprintf(stderr, " [-zEXPONENT] [-kSPREAD] [-sSEED]\n");
+   fprintf(stderr, "   TYPE: zipf, uniform or collide\n");
+   fprintf(stderr, "   defaults: -w1000000 -u100000 -z1.0 -k64 -s1\n");
+   exit(EXIT_FAILURE);
+}
+
+static void gc_options(int argc, char *argv[], GenOptions *opts)
+{
+   unsigned long long value;
+   int i, ok;
+
+   for (i = 1; i < argc; i++)
+   {
+      ok = argv[i][0] == '-' && argv[i][1] != '\0';
+      if (ok && argv[i][1] == 't')
+         opts -> type = argv[i] + 2;
+      else if (ok && argv[i][1] == 'z')
+         ok = sscanf(argv[i] + 2, "%lf", &opts -> exponent) == 1 && \
+            opts -> exponent > 0;
+      else if (ok && (ok = sscanf(argv[i] + 2, "%llu", &value) == 1))
+      {
+         if (argv[i][1] == 'w')
+            opts -> words = value;
+         else if (argv[i][1] == 'u' && value > 0)
+            opts -> unique = value;
+         else if (argv[i][1] == 'k' && value > 0 && value <= 1 << 20)
+            opts -> spread = value;
+         else if (argv[i][1] == 's')
+            opts -> seed = value;
+         else
+            ok = FALSE;
+      }
+      if (!ok)
+         gc_usage();
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   GenOptions opts = {NULL, 1000000, 100000, 1.0, 64, 1};
+
+   gc_options(argc, argv, &opts);
+   if (opts.type == NULL)
+      gc_usage();
+   gc_seed(opts.seed);
+   if (strcmp(opts.type, "zipf") == 0)
+      gc_zipf(&opts);
+   else if (strcmp(opts.type, "uniform") == 0)
+      gc_uniform_words(&opts);
+   else if (strcmp(opts.type, "collide") == 0)
+      gc_collide(&opts);
+   else
+      gc_usage();
+   if (opts.words % GC_LINE_WORDS != 0)
+      putchar('\n');
+   if (fflush(stdout) != 0)
+   {
+      perror("gencorpus");
+      return EXIT_FAILURE;
+   }
+   return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Times the stages of wf's serial pipeline on one corpus and writes the
+ * results as one JSON object on a line of its own, so that the lines of
+ * several runs, or of several commits, can be collected and compared.
+ *
+ *    tokenize: a WordSource pass over the corpus that only counts words.
+ *    add: a second pass that also interns every word (open_read_helper, as
+ *       wf does), less the tokenize time.
+ *    toArray: htToArray64.
+ *    sort: sortHTEntries of every unique word, -jN threads.
+ *    print: print_output of the sorted words (-n of them, all by default,
+ *       in the -f format) to /dev/null.
+ *
+ * Each stage reports its fastest time of -rRUNS runs. The chain statistics
+ * are those of htMetrics after the count, and the peak RSS is the process's
+ * (getrusage), so measure one corpus per process.
+ *
+ * Usage: wfbench [-rRUNS] [-cLABEL] [-nX] [-eENGINE] [-hHASH] [-jN]
+ *    [-fFORMAT] corpus
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "../getWord.h"
+#include "../hashTable.h"
+#include "../hashTable64.h"
+#include "../hashWord.h"
+#include "../sortHTEntries.h"
+#include "../wordSource.h"
+#include "../output.h"
+#include "../main.h"
+
+#define BENCH_STAGES 5
+
+static const char *benchStageNames[BENCH_STAGES] = {
+   "tokenize", "add", "toArray", "sort", "print"
+};
+
+typedef struct
+{
+   double seconds[BENCH_STAGES];   /* fastest of the runs */
+   uint64_t bytes, tokens, unique;
+   HTMetrics metrics;
+} BenchResult;
+
+static double bench_now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_usage(void)
+{
+   fprintf(stderr, "Usage: wfbench [-rRUNS] [-cLABEL] [-nX] [-eENGINE]");
+   fprintf(stderr, " [-hHASH] [-jN] [-fFORMAT] corpus\n");
+   exit(EXIT_FAILURE);
+}
+
+static uint64_t bench_tokenize(const char *corpus)
+{
+   WordSource *ws = wsOpenFd(fileOpen(corpus));
+   Byte *word;
+   unsigned length;
+   int hasPrintable;
+   uint64_t tokens = 0;
+
+   while (EOF != wsNextWord(ws, &word, &length, &hasPrintable))
+      tokens += hasPrintable == TRUE;
+   wsClose(ws);
+   return tokens;
+}
+
+/*
+ * Writes to /dev/null through stdout, which is where print_output writes.
+ */
+static double bench_print(HTEntry64 *entries, uint64_t size, uint64_t total, \
+   Options *opts)
+{
+   int saved = dup(STDOUT_FILENO), null = open("/dev/null", O_WRONLY);
+   double start;
+
+   if (saved < 0 || null < 0 || dup2(null, STDOUT_FILENO) < 0)
+   {
+      perror("wfbench");
+      exit(EXIT_FAILURE);
+   }
+   start = bench_now();
+   print_output(entries, NULL, size, size, total, opts);
+   start = bench_now() - start;
+   dup2(saved, STDOUT_FILENO);
+   close(saved);
+   close(null);
+   return start;
+}
+
+static void bench_keep(BenchResult *result, int run, int stage, double t)
+{
+   if (run == 0 || t < result -> seconds[stage])
+      result -> seconds[stage] = t;
+}
+
+static void bench_run(const char *corpus, Options *opts, BenchResult *result, \
+   int run)
+{
+   HTEntry64 *entries;
+   uint64_t size;
+   double t, tokenize;
+   void *ht;
+
+   t = bench_now();
+   result -> tokens = bench_tokenize(corpus);
+   bench_keep(result, run, 0, tokenize = bench_now() - t);
+
+   ht = createTable(opts);
+   t = bench_now();
+   open_read_helper(wsOpenFd(fileOpen(corpus)), ht);
+   t = bench_now() - t - tokenize;
+   bench_keep(result, run, 1, t > 0 ? t : 0);
+   result -> unique = htUniqueEntries64(ht);
+   result -> metrics = htMetrics(ht);
+
+   t = bench_now();
+   entries = htToArray64(ht, &size);
+   bench_keep(result, run, 2, bench_now() - t);
+
+   t = bench_now();
+   sortHTEntries(entries, size, opts -> threads);
+   bench_keep(result, run, 3, bench_now() - t);
+
+   bench_keep(result, run, 4, bench_print(entries, size, \
+      htTotalEntries64(ht), opts));
+   free(entries);
+   htDestroy(ht);
+}
+
+static void bench_double(Output *out, const char *name, double value, \
+   const char *after)
+{
+   char number[64];
+
+   snprintf(number, sizeof(number), "%.6f", value);
+   outJson(out, (const Byte*)name, strlen(name));
+   outByte(out, ':');
+   outString(out, number);
+   outString(out, after);
+}
+
+static void bench_uint(Output *out, const char *name, uint64_t value, \
+   const char *after)
+{
+   outJson(out, (const Byte*)name, strlen(name));
+   outByte(out, ':');
+   outUint(out, value, 0);
+   outString(out, after);
+}
+
+static void bench_string(Output *out, const char *name, const char *value, \
+   const char *after)
+{
+   outJson(out, (const Byte*)name, strlen(name));
+   outByte(out, ':');
+   outJson(out, (const Byte*)value, strlen(value));
+   outString(out, after);
+}
+
+static void bench_report(const char *label, const char *corpus, \
+   const char *engine, int runs, BenchResult *result)
+{
+   Output *out = outOpen(STDOUT_FILENO);
+   struct rusage usage;
+   double pipeline = result -> seconds[0] + result -> seconds[1];
+   int i;
+
+   getrusage(RUSAGE_SELF, &usage);
+   outByte(out, '{');
+   bench_string(out, "label", label, ",");
+   bench_string(out, "corpus", corpus, ",");
+   bench_string(out, "engine", engine, ",");
+   bench_uint(out, "runs", runs, ",");
+   bench_uint(out, "bytes", result -> bytes, ",");
+   bench_uint(out, "tokens", result -> tokens, ",");
+   bench_uint(out, "unique", result -> unique, ",\"seconds\":{");
+   for (i = 0; i < BENCH_STAGES; i++)
+      bench_double(out, benchStageNames[i], result -> seconds[i], \
+         i < BENCH_STAGES - 1 ? "," : "},");
+   bench_double(out, "tokenizeTokensPerSecond", \
+      result -> tokens / result -> seconds[0], ",");
+   bench_double(out, "countTokensPerSecond", result -> tokens / pipeline, \
+      ",");
+   bench_uint(out, "peakRssKiB", usage.ru_maxrss, ",\"chains\":{");
+   bench_uint(out, "number", result -> metrics.numberOfChains, ",");
+   bench_uint(out, "maxLength", result -> metrics.maxChainLength, ",");
+   bench_double(out, "avgLength", result -> metrics.avgChainLength, "}}\n");
+   outClose(out);
+}
+
+int main(int argc, char *argv[])
+{
+   Options opts = {INT_MAX, HT_ARENA, 1, hashWord, hashWord64};
+   const char *label = "", *corpus = NULL, *engine = "chain";
+   BenchResult result;
+   struct stat st;
+   int runs = 1, i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (argv[i][0] != '-')
+         corpus = argv[i];
+      else if (argv[i][1] == 'r')
+      {
+         if (sscanf(argv[i], "-r%d", &runs) != 1 || runs < 1)
+            bench_usage();
+      }
+      else if (argv[i][1] == 'c')
+         label = argv[i] + 2;
+      else
+      {
+         if (argv[i][1] == 'e')
+            engine = argv[i] + 2;
+         check_option(argv[i], &opts);
+      }
+   }
+   if (corpus == NULL || opts.num_line < 1 || opts.epsilon > 0 || \
+      opts.budget > 0 || opts.numLoad > 0 || opts.dump != NULL || \
+      opts.mergeOnly)
+      bench_usage();
+   if (stat(corpus, &st) != 0)
+   {
+      perror(corpus);
+      return EXIT_FAILURE;
+   }
+   memset(&result, 0, sizeof(BenchResult));
+   result.bytes = st.st_size;
+   for (i = 0; i < runs; i++)
+      bench_run(corpus, &opts, &result, i);
+   bench_report(label, corpus, engine, runs, &result);
+   return 0;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hashTableExt.h"
+#include "qsortHTEntriesExt.h"
+#include "wordSource.h"
+#include "sizing.h"
+#include "external.h"
+
+static void* ec_alloc(size_t count, size_t size)
+{
+   void *ptr = calloc(count, size);
+   alloc_exit(ptr);
+   return ptr;
+}
+
+/*
+ * A table of a single size never rehashes: the chained engines stop at
+ * their last size, and HT_OPEN only grows beyond it past OA_MAX_LOAD, which
+ * ec_full keeps it below.
+ */
+static void* ec_table(ExternalCount *ec)
+{
+   return createTableSizes(ec -> opts, &ec -> capacity, 1);
+}
+
+/*
+ * The sorted spill needs an HTEntry64 per word on top of the table, so that
+ * array is counted against the budget too.
+ */
+static int ec_full(ExternalCount *ec)
+{
+   uint64_t unique = htUniqueEntries64(ec -> table);
+
+   return unique >= WF_LOAD_FACTOR * ec -> capacity || \
+      htFootprint64(ec -> table) + unique * sizeof(HTEntry64) >= \
+         ec -> opts -> budget;
+}
+
+static void ec_add_run(ExternalCount *ec, Snapshot *run, char *name)
+{
+   if (ec -> numRuns == ec -> maxRuns)
+   {
+      ec -> maxRuns = ec -> maxRuns * 2 + 8;
+      ec -> runs = realloc(ec -> runs, ec -> maxRuns * sizeof(Snapshot*));
+      ec -> runNames = realloc(ec -> runNames, ec -> maxRuns * sizeof(char*));
+      alloc_exit(ec -> runs);
+      alloc_exit(ec -> runNames);
+   }
+   ec -> runs[ec -> numRuns] = run;
+   ec -> runNames[(ec -> numRuns)++] = name;
+}
+
+/*
+ * Writes the table as a sorted run and starts over with an empty one.
+ */
+static void ec_spill(ExternalCount *ec)
+{
+   const char *dir = getenv("TMPDIR");
+   char *name;
+   int fd;
+
+   if (dir == NULL || *dir == '\0')
+      dir = "/tmp";
+   name = ec_alloc(strlen(dir) + sizeof("/wfrunXXXXXX"), 1);
+   sprintf(name, "%s/wfrunXXXXXX", dir);
+   if ((fd = mkstemp(name)) < 0)
+   {
+      fprintf(stderr, "wf: %s: ", name);
+      perror("");
+      exit(EXIT_FAILURE);
+   }
+   close(fd);
+   snapDump(&ec -> table, 1, name, TRUE);
+   ec_add_run(ec, snapOpen(name), name);
+   unlink(name);
+   statsTables(ec -> opts -> stats, &ec -> table, 1);
+   htDestroy(ec -> table);
+   ec -> table = ec_table(ec);
+}
+
+static void ec_add(ExternalCount *ec, const Word *word, uint64_t count, \
+   FNClone clone)
+{
+   void *ht = ec -> table;
+
+   /* Only new words make the table grow */
+   if (htInternCount64(ht, word, count, clone, htArena(ht)) == count && \
+      ec_full(ec))
+      ec_spill(ec);
+}
+
+static void ec_read(ExternalCount *ec, WordSource *ws)
+{
+   Word word;
+   int hasPrintable;
+
+   while (EOF != wsNextWord(ws, &word.bytes, &word.length, &hasPrintable))
+   {
+      if (hasPrintable == TRUE)
+         ec_add(ec, &word, 1, cloneWord);
+   }
+   wsClose(ws);
+}
+
+void ecCount(ExternalCount *ec, int task, int argc, char *argv[], \
+   Snapshot **snaps, Options *opts)
+{
+   int i;
+
+   memset(ec, 0, sizeof(ExternalCount));
+   ec -> opts = opts;
+   ec -> capacity = opts -> budget / EC_TABLE_SHARE / EC_BUCKET_BYTES;
+   ec -> capacity = szPrime(ec -> capacity < 359 ? 359 : ec -> capacity);
+   ec -> table = ec_table(ec);
+   for (i = 0; i < opts -> numLoad; i++)
+   {
+      if (snaps[i] -> flags & SNAP_SORTED)
+         ec_add_run(ec, snaps[i], NULL);
+      else
+      {
+         while (snapNext(snaps[i]))
+            ec_add(ec, &snaps[i] -> word, snaps[i] -> frequency, borrowWord);
+      }
+   }
+   for (i = 1; task == 1 && i < argc; i++)
+   {
+      if (argv[i][0] != '-')
+         ec_read(ec, wsOpenFd(fileOpen(argv[i])));
+   }
+   if (task != 1)
+      ec_read(ec, wsOpenFd(STDIN_FILENO));
+}
+
+/*
+ * FNSnapVisit of the final merge. The merged word only gets a header of its
+ * own when the ranking keeps it, its bytes stay in the run. At most k + 1
+ * headers are allocated: the one of an evicted entry is reused.
+ */
+static void ec_rank_visit(const Word *word, uint64_t frequency, \
+   void *context)
+{
+   ExternalCount *ec = context;
+   HTEntry64 entry;
+
+   (ec -> unique)++;
+   ec -> total += frequency;
+   if (ec -> dump != NULL)
+      snapWrite(ec -> dump, word, frequency);
+   entry.data = (void*)word;
+   entry.frequency = frequency;
+   if (!topKAccepts(ec -> topK, &entry))
+      return;
+   if (ec -> spare == NULL)
+      ec -> spare = arenaAlloc(ec -> words, sizeof(Word));
+   *ec -> spare = *word;
+   entry.data = ec -> spare;
+   /* A full selection evicts heap[0], whose header becomes the spare */
+   ec -> spare = ec -> topK -> size == ec -> topK -> k ? \
+      ec -> topK -> heap[0].data : NULL;
+   topKPush(ec -> topK, entry);
+}
+
+HTEntry64* ecRank(ExternalCount *ec, uint64_t *size)
+{
+   Options *opts = ec -> opts;
+
+   if (htUniqueEntries64(ec -> table) > 0)
+      ec_spill(ec);
+   ec -> words = arenaCreate(0);
+   ec -> topK = topKCreate(opts -> num_line, compareHTEntries64);
+   if (opts -> dump != NULL)
+      ec -> dump = snapCreate(opts -> dump, SNAP_SORTED);
+   snapMergeEach(ec -> runs, ec -> numRuns, ec_rank_visit, ec);
+   if (ec -> dump != NULL)
+      snapFinish(ec -> dump);
+   return topKFinish(ec -> topK, size);
+}
+
+void ecDestroy(ExternalCount *ec)
+{
+   int i;
+
+   for (i = 0; i < ec -> numRuns; i++)
+   {
+      if (ec -> runNames[i] != NULL)
+         snapClose(ec -> runs[i]);
+      free(ec -> runNames[i]);
+   }
+   free(ec -> runs);
+   free(ec -> runNames);
+   htDestroy(ec -> table);
+   if (ec -> words != NULL)
+      arenaDestroy(ec -> words);
+}
@@ -0,0 +1,69 @@
+#ifndef EXTERNAL_H
+#define EXTERNAL_H
+
+/*
+ * Bounded-memory word counting for wf -mMEGABYTES.
+ *
+ * Words are counted in a hash table whose capacity is fixed from the budget,
+ * so it never rehashes. Before it outgrows the budget, or gets fuller than
+ * WF_LOAD_FACTOR, its entries are spilled as a sorted snapshot (see
+ * snapshot.h) to a temporary file and counting starts over in an empty
+ * table. At the end the runs, and the sorted snapshots loaded with -l, are
+ * merged in one streaming pass that sums the counts of each word, and the
+ * ranking is selected from that stream with a bounded heap. The result is
+ * exact, and memory use is the budget plus the -n ranked entries. The
+ * budget covers the table and the array of its entries that is sorted when
+ * it is spilled.
+ *
+ * Runs are written to $TMPDIR (/tmp when unset) and unlinked as soon as they
+ * are mapped, so none is left behind however wf exits.
+ */
+#include "hashTable64.h"
+#include "snapshot.h"
+#include "topK.h"
+#include "arena.h"
+#include "main.h"
+
+#define EC_MIN_MEGABYTES 16  /* well above the arena's slab size */
+#define EC_TABLE_SHARE 4     /* 1/EC_TABLE_SHARE of the budget for arrays */
+#define EC_BUCKET_BYTES 40   /* at least one bucket or HT_OPEN slot */
+
+typedef struct
+{
+   Options *opts;
+   void *table;            /* words counted since the last spill */
+   uint64_t capacity;      /* of every table */
+   Snapshot **runs;        /* sorted -l snapshots, then spilled runs */
+   char **runNames;        /* NULL for -l snapshots, which are not owned */
+   int numRuns, maxRuns;
+   uint64_t unique, total; /* of the merged count, set by ecRank */
+   Arena *words;           /* Word headers of the ranked entries */
+   Word *spare;            /* unused header, NULL when there is none */
+   TopK *topK;
+   SnapWriter *dump;
+} ExternalCount;
+
+/* Description: Counts the -l snapshots and the input (the file arguments
+ *    when task is 1, otherwise stdin), spilling to runs as needed. When
+ *    numRuns is 0 afterwards nothing was spilled and table holds the whole
+ *    count. Sorted snapshots are not added to the table but become runs
+ *    themselves.
+ */
+void ecCount(ExternalCount *ec, int task, int argc, char *argv[], \
+   Snapshot **snaps, Options *opts);
+
+/* Description: Spills what is left in the table and merges every run and
+ *    sorted snapshot. Sets unique and total, writes the merged count to
+ *    opts -> dump (sorted, whether -d or -D) when set, and returns the
+ *    first opts -> num_line entries in compareHTEntries64 order.
+ *
+ * Return: A dynamically allocated array (NULL when empty) the caller frees,
+ *    size is set to its length. Its words stay valid until ecDestroy.
+ */
+HTEntry64* ecRank(ExternalCount *ec, uint64_t *size);
+
+/* Description: Frees the table, the runs and the ranked words.
+ */
+void ecDestroy(ExternalCount *ec);
+
+#endif
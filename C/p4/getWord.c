@@ -5,6 +5,7 @@
 
 #define TRUE 1
 #define FALSE 0
+#define GW_INITIAL_SIZE 12
 
 void error_message(void *ptr)
 {
@@ -15,47 +16,54 @@ void error_message(void *ptr)
    }
 }
 
-void getWordHelper1(int ch, Byte **p, unsigned *length,int *printable,int *size)
+void getWordHelper1(int ch, Byte **p, unsigned *length, int *printable, \
+   unsigned *size)
 {
-   ch = tolower(ch);
    if (*length == *size)
    {
       (*size) *= 2;
       *p = realloc(*p, (*size));
       error_message(*p);
    }
-   if (!isspace(ch))
-      (*p)[(*length)++] = ch;
-   if (isprint(ch) && !isspace(ch))
+   (*p)[(*length)++] = tolower(ch);
+   if (isprint(ch))
       (*printable) = TRUE;
 }
 
-void getWordHelper2(int *hasPrintable, unsigned *wordLength, int printable, \
-   int length)
+/*
+ * Reads a word into *buffer, which is grown (to at least GW_INITIAL_SIZE)
+ * as needed and kept by the caller, like getline's. Returns as getWord.
+ */
+static int gw_read(FILE *file, Byte **buffer, unsigned *bufferSize, \
+   unsigned *wordLength, int *hasPrintable)
 {
-   *hasPrintable = printable;
+   int ch, printable = FALSE;
+   unsigned length = 0;
+   if (*buffer == NULL || *bufferSize == 0)
+   {
+      *bufferSize = GW_INITIAL_SIZE;
+      *buffer = realloc(*buffer, *bufferSize);
+      error_message(*buffer);
+   }
+   while ((ch = getc(file)) != EOF)
+   {
+      if (!isspace(ch))
+         getWordHelper1(ch, buffer, &length, &printable, bufferSize);
+      else if (length > 0)
+         break;
+   }
    *wordLength = length;
-   printable = length = 0;
+   *hasPrintable = printable;
+   return ch == EOF ? EOF : 0;
 }
 
 int getWord(FILE *file, Byte **word, unsigned *wordLength, int *hasPrintable)
 {
-   int ch, printable = 0, size = 12;
-   unsigned length = 0;
-   Byte *p = malloc(size*sizeof(Byte));
-   error_message(p);
-   while ((ch = getc(file)) != EOF)
-   {
-      getWordHelper1(ch, &p, &length, &printable, &size);
-      if (isspace(ch) && length > 0)
-      {
-         *word = realloc(p, length);
-         error_message(*word);
-         getWordHelper2(hasPrintable, wordLength, printable, length);
-         return 0;
-      }
-   }
-   *word = realloc(p, length);
-   getWordHelper2(hasPrintable, wordLength, printable, length);
-   return EOF;
+   Byte *p = NULL;
+   unsigned size = 0;
+   int ret = gw_read(file, &p, &size, wordLength, hasPrintable);
+   *word = realloc(p, *wordLength);
+   if (*wordLength > 0)
+      error_message(*word);
+   return ret;
 }
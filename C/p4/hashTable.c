@@ -1,50 +1,13 @@
 #include <stdio.h>
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "hashTable.h"
+#include "hashTableExt.h"
 #include "getWord.h"
-
-#define FALSE 0
-#define TRUE  1
-/*
- * This is the fundamental type of a hash table using separate
- * chaining as its collision strategy. It will only be used by the
- * hash table so it can be defined in your hash table source file so
- * that it is private/file local.
- */
-typedef struct node
-{
-   /* Other unspecified fields you deem necessary here... */
-   void *data;
-   unsigned frequency;
-   unsigned hash;
-   /* The quintisential "next" pointer */
-   struct node *next;
-} HashNode;
-
-/*
- * This is the structure representing a hash table. It will be defined
- * in your hash table source file so that it is private/file local. And,
- * you will be allocating dynamic memory for one so that you can return
- * a void* to one from the htCreate "constructor-like" function.
- *
- * Notice that theArray is a double-pointer. That is because it is an
- * array (a pointer) of HashNode pointers!
- */
-typedef struct
-{
-   /* Other unspecified fields you deem necessary here... */
-   HTFunctions *theFunctions;
-   unsigned *theSizes;
-   unsigned rehash;
-   unsigned unique;
-   unsigned total;
-   float loadFactor;
-   int sizes;
-   /* The quintessential "hash table", a.k.a., an array of node pointers */
-   HashNode **theArray;
-} HashTable;
+#include "arena.h"
+#include "hashTablePriv.h"
 
 /* 
  * malloc failure caller function.
@@ -89,6 +52,34 @@ void alloc_message(void *pointer)
 
 void* htCreate(HTFunctions *functions, unsigned sizes[], int numSizes, \
    float rehashLoadFactor)
+{
+   return htCreateEx(functions, sizes, numSizes, rehashLoadFactor, 0);
+}
+
+/* Description: htCreate with storage/engine flags, see hashTableExt.h.
+ */
+void* htCreateEx(HTFunctions *functions, unsigned sizes[], int numSizes, \
+   float rehashLoadFactor, int flags)
+{
+   int i;
+   void *hashTable;
+   uint64_t *sizes64;
+
+   assert(numSizes >= 1);
+   sizes64 = malloc(numSizes * sizeof(uint64_t));
+   alloc_message(sizes64);
+   for (i = 0; i < numSizes; i++)
+      sizes64[i] = sizes[i];
+   hashTable = htCreate64(functions, sizes64, numSizes, rehashLoadFactor, \
+      flags);
+   free(sizes64);
+   return hashTable;
+}
+
+/* Description: htCreateEx with 64-bit sizes, see hashTable64.h.
+ */
+void* htCreate64(HTFunctions *functions, uint64_t sizes[], int numSizes, \
+   float rehashLoadFactor, int flags)
 {
    int i;
    HashTable *hashTable;
@@ -109,18 +100,38 @@ void* htCreate(HTFunctions *functions, unsigned sizes[], int numSizes, \
    alloc_message(hashTable -> theFunctions);
    memcpy(hashTable -> theFunctions, functions, sizeof(HTFunctions));
 
-   hashTable -> theSizes = (unsigned*)malloc(numSizes*sizeof(unsigned));
+   hashTable -> theSizes = (uint64_t*)malloc(numSizes*sizeof(uint64_t));
    alloc_message(hashTable -> theSizes);
-   memcpy(hashTable -> theSizes, sizes, numSizes*sizeof(unsigned));
+   memcpy(hashTable -> theSizes, sizes, numSizes*sizeof(uint64_t));
    
-   hashTable -> theArray = calloc(sizes[0], sizeof(HashNode*));
-   alloc_message(hashTable -> theArray);
-
    hashTable -> rehash = 0;
+   setCapacity(hashTable);
    hashTable -> unique = 0;
    hashTable -> total = 0;
    hashTable -> loadFactor = rehashLoadFactor;
    hashTable -> sizes = numSizes;
+   hashTable -> flags = flags;
+   hashTable -> arena = (flags & HT_ARENA) && !(flags & HT_CONCURRENT) ? \
+      arenaCreate(0) : NULL;
+   hashTable -> theArray = NULL;
+   hashTable -> ctrl = NULL;
+   hashTable -> slots = NULL;
+   hashTable -> prefix = NULL;
+   hashTable -> hash64 = NULL;
+   hashTable -> oldArray = NULL;
+   hashTable -> oldCapacity = hashTable -> migrated = 0;
+   hashTable -> segments = NULL;
+   hashTable -> stats = NULL;
+   assert(!((flags & HT_OPEN) && (flags & HT_INCREMENTAL)));
+   if (flags & HT_CONCURRENT)
+      ccCreate(hashTable, sizes, numSizes);
+   else if (flags & HT_OPEN)
+      oaCreate(hashTable);
+   else
+   {
+      hashTable -> theArray = calloc(sizes[0], sizeof(HashNode*));
+      alloc_message(hashTable -> theArray);
+   }
 
    return hashTable;
 }
@@ -140,35 +151,51 @@ void htDestroy_helper(void *hashTable, HashNode *the_node)
 {
    HashNode *temp_node;
    FNDestroy destroyFunc = ((HashTable*)hashTable) -> theFunctions -> destroy;
+   int words = ((HashTable*)hashTable) -> flags & HT_WORDS;
 
    while (the_node != NULL)
    {
-      if (destroyFunc != NULL)
+      if (destroyFunc != NULL && !words)
          destroyFunc(the_node -> data);
       temp_node = the_node;
       the_node = the_node -> next;
-      free(temp_node -> data);
+      if (!words)
+         free(temp_node -> data);
       free(temp_node);
    }
 }
 
 void htDestroy(void *hashTable)
 {
-   int i;
+   uint64_t i;
    HashNode *the_node;
-   unsigned *sizesArray = ((HashTable*)hashTable) -> theSizes;
+   uint64_t *sizesArray = ((HashTable*)hashTable) -> theSizes;
    unsigned rehashCount = ((HashTable*)hashTable) -> rehash;
    HashNode **nodeArray = ((HashTable*)hashTable) -> theArray;
+   HashNode **oldArray = ((HashTable*)hashTable) -> oldArray;
    HTFunctions *hereFunctions = ((HashTable*)hashTable) -> theFunctions;
+   Arena *arena = ((HashTable*)hashTable) -> arena;
 
-   for (i = 0; i < sizesArray[rehashCount]; i++)
+   if (((HashTable*)hashTable) -> segments != NULL)
+      ccDestroy(hashTable);
+   else if (nodeArray == NULL)
+      oaDestroy(hashTable);
+   if (arena != NULL)
+      arenaDestroy(arena);
+   for (i = 0; arena == NULL && nodeArray != NULL && \
+      i < sizesArray[rehashCount]; i++)
    {
       the_node = nodeArray[i];
       htDestroy_helper(hashTable, the_node);
    }
+   for (i = 0; arena == NULL && oldArray != NULL && \
+      i < ((HashTable*)hashTable) -> oldCapacity; i++)
+      htDestroy_helper(hashTable, oldArray[i]);
+   free(oldArray);
    free(nodeArray);
    free(sizesArray);
    free(hereFunctions);
+   free(((HashTable*)hashTable) -> stats);
    free((HashTable*)hashTable);
 }
 
@@ -201,26 +228,88 @@ void htDestroy(void *hashTable)
 void rehashHelper(void *hashTable, HashNode *the_node, HashNode **newArray)
 {
    HashNode *temp_node;
-   unsigned new_index;
+   uint64_t new_index, capacity = ((HashTable*)hashTable) -> capacity;
 
    while (the_node != NULL)
    {
       temp_node = the_node -> next;
-      new_index = (the_node -> hash) % htCapacity(hashTable);
+      new_index = (the_node -> hash) % capacity;
       the_node -> next = newArray[new_index];
       newArray[new_index] = the_node;
       the_node = temp_node;
    }
 }
 
+/*
+ * HT_INCREMENTAL: migrates up to the specified number of old buckets to the
+ * new array, freeing the old array once it is empty.
+ */
+void rehashStep(void *hashTable, uint64_t buckets)
+{
+   HashTable *ht = (HashTable*)hashTable;
+
+   while (ht -> oldArray != NULL && buckets-- > 0)
+   {
+      rehashHelper(hashTable, ht -> oldArray[ht -> migrated], ht -> theArray);
+      ht -> oldArray[ht -> migrated] = NULL;
+      if (++(ht -> migrated) == ht -> oldCapacity)
+      {
+         free(ht -> oldArray);
+         ht -> oldArray = NULL;
+      }
+   }
+}
+
+/*
+ * HT_INCREMENTAL: the old array stays live while rehashStep moves its
+ * buckets, data whose old bucket has not moved yet is still found there.
+ */
+HashNode** homeBucket(void *hashTable, unsigned long long raw_hash)
+{
+   HashTable *ht = (HashTable*)hashTable;
+
+   if (ht -> oldArray != NULL && raw_hash % ht -> oldCapacity >= ht -> migrated)
+      return &(ht -> oldArray)[raw_hash % ht -> oldCapacity];
+   return &(ht -> theArray)[raw_hash % ht -> capacity];
+}
+
+void rehashStart(void *hashTable, unsigned herehHash)
+{
+   HashTable *ht = (HashTable*)hashTable;
+
+   rehashStep(hashTable, UINT64_MAX);
+   ht -> oldArray = ht -> theArray;
+   ht -> oldCapacity = ht -> capacity;
+   ht -> migrated = 0;
+   ht -> rehash = herehHash + 1;
+   setCapacity(ht);
+   ht -> theArray = calloc(ht -> capacity, sizeof(HashNode*));
+   alloc_message(ht -> theArray);
+}
+
+void rehashCount(HashTable *hashTable)
+{
+   if (hashTable -> stats == NULL)
+      return;
+   (hashTable -> stats -> rehashes)++;
+   countAllocated(hashTable, htCapacity64(hashTable) * sizeof(HashNode*));
+}
+
 void rehash(void *hashTable, unsigned herehHash, int hereSizes)
 {
-   int i;
+   uint64_t i;
    HashNode *the_node;
    HashNode **newArray, **temp_array;
-   unsigned *hereListSizes = ((HashTable*)hashTable) -> theSizes;
+   uint64_t *hereListSizes = ((HashTable*)hashTable) -> theSizes;
 
+   if (((HashTable*)hashTable) -> flags & HT_INCREMENTAL)
+   {
+      rehashStart(hashTable, herehHash);
+      rehashCount(hashTable);
+      return;
+   }
    ((HashTable*)hashTable) -> rehash = herehHash + 1;
+   setCapacity(hashTable);
    newArray = calloc(hereListSizes[((HashTable*)hashTable) -> rehash], \
       sizeof(HashNode*));
    alloc_message(newArray);
@@ -233,30 +322,70 @@ void rehash(void *hashTable, unsigned herehHash, int hereSizes)
    temp_array = ((HashTable*)hashTable) -> theArray;
    ((HashTable*)hashTable) -> theArray = newArray;
    free(temp_array);
+   rehashCount(hashTable);
 }
 
-unsigned addData(void *hashTable, void *data, unsigned raw_hash, int *decider)
+/*
+ * Allocates the node of new data: a WordNode holding a copy of the word
+ * (or only its header under HT_BORROW) when words, else a HashNode holding
+ * data or its clone.
+ */
+static HashNode* ht_node(HashTable *hashTable, const void *data, int words, \
+   FNClone clone, void *context)
+{
+   const Word *word = data;
+   int borrow = hashTable -> flags & HT_BORROW;
+   size_t size = !words ? sizeof(HashNode) : \
+      sizeof(WordNode) + (borrow ? 0 : word -> length);
+   HashNode *node;
+   WordNode *wordNode;
+
+   countAllocated(hashTable, size);
+   if (hashTable -> arena != NULL)
+      node = arenaAlloc(hashTable -> arena, size);
+   else
+      node = (HashNode*)malloc(size);
+   alloc_message(node);
+   if (!words)
+   {
+      node -> data = clone == NULL ? (void*)data : clone(data, context);
+      return node;
+   }
+   wordNode = (WordNode*)node;
+   wordNode -> word = *word;
+   if (!borrow)
+   {
+      wordNode -> word.bytes = (Byte*)(wordNode + 1);
+      memcpy(wordNode -> word.bytes, word -> bytes, word -> length);
+   }
+   return node;
+}
+
+uint64_t addData(void *hashTable, const void *data, uint64_t count, \
+   unsigned long long raw_hash, int *decider, FNClone clone, void *context)
 {
    HashNode *current, *new, **nextp;
-   HashNode **hereAray = ((HashTable*)hashTable) -> theArray;
-   FNCompare compareFunc = ((HashTable*)hashTable) -> theFunctions -> compare;
-   nextp = &hereAray[raw_hash % htCapacity(hashTable)];
+   int words = ((HashTable*)hashTable) -> flags & HT_WORDS;
+   uint64_t probes = 0, compares = 0;
+   nextp = homeBucket(hashTable, raw_hash);
 
    while ((current = *nextp) != NULL)
    {
-      if (compareFunc(current -> data, data) == 0)
+      probes++;
+      if (current -> hash == raw_hash && (compares++, \
+         nodeEqual(hashTable, current, data, words)))
       {
-         (current -> frequency)++;
-         (((HashTable*)hashTable) -> total)++;
+         countProbes(hashTable, probes, compares);
+         current -> frequency += count;
+         ((HashTable*)hashTable) -> total += count;
          *decider = TRUE;
          return (current -> frequency);
       }
       nextp = &current -> next;
    }
-   new = (HashNode*)malloc(sizeof(HashNode));
-   alloc_message(new);
-   new -> data = data;
-   new -> frequency = 1;
+   countProbes(hashTable, probes, compares);
+   new = ht_node(hashTable, data, words, clone, context);
+   new -> frequency = count;
    new -> hash = raw_hash;
    new -> next = current;
    *nextp = new;
@@ -264,30 +393,187 @@ unsigned addData(void *hashTable, void *data, unsigned raw_hash, int *decider)
    return (new -> frequency);
 }
 
-unsigned htAdd(void *hashTable, void *data)
+uint64_t addOrIntern(void *hashTable, const void *data, uint64_t count, \
+   FNClone clone, void *context)
+{
+   return addOrInternHashed(hashTable, data, rawHash(hashTable, data), count, \
+      clone, context);
+}
+
+uint64_t addOrInternHashed(void *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context)
 {
    int decider;
-   unsigned freq;
+   uint64_t freq;
    float hereFactor = ((HashTable*)hashTable) -> loadFactor;
    int hereSizes = ((HashTable*)hashTable) -> sizes;
    unsigned herehHash = ((HashTable*)hashTable) -> rehash;
 
-   assert(data != NULL);
-
-   if ((hereFactor < 1) && (herehHash < (hereSizes - 1)) && \
-      (((float)htUniqueEntries(hashTable) / htCapacity(hashTable)) >hereFactor))
-      rehash(hashTable, herehHash, hereSizes);
-
-   freq = addData(hashTable, data, (((HashTable*)hashTable) -> theFunctions -> \
-      hash)(data), &decider);
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccAdd(hashTable, data, hash, count, clone, context);
+   if (((HashTable*)hashTable) -> flags & HT_OPEN)
+   {
+      oaGrow(hashTable);
+      freq = oaAdd(hashTable, data, hash, count, &decider, clone, context);
+   }
+   else
+   {
+      rehashStep(hashTable, HT_MIGRATE_BUCKETS);
+      if ((hereFactor < 1) && (herehHash < (hereSizes - 1)) && \
+      (((double)htUniqueEntries64(hashTable) / htCapacity64(hashTable)) > \
+      hereFactor))
+         rehash(hashTable, herehHash, hereSizes);
+      freq = addData(hashTable, data, count, hash, &decider, clone, context);
+   }
    if (decider == TRUE)
       return freq;
    (((HashTable*)hashTable) -> unique)++;
-   (((HashTable*)hashTable) -> total)++;
+   ((HashTable*)hashTable) -> total += count;
 
    return freq;
 }
 
+unsigned htAdd(void *hashTable, void *data)
+{
+   return saturate(htAdd64(hashTable, data));
+}
+
+uint64_t htAdd64(void *hashTable, void *data)
+{
+   assert(data != NULL);
+   return addOrIntern(hashTable, data, 1, NULL, NULL);
+}
+
+/* Description: Lookup-or-insert, see hashTableExt.h.
+ */
+unsigned htIntern(void *hashTable, const void *data, FNClone clone, \
+   void *context)
+{
+   return saturate(htIntern64(hashTable, data, clone, context));
+}
+
+uint64_t htIntern64(void *hashTable, const void *data, FNClone clone, \
+   void *context)
+{
+   assert(data != NULL && clone != NULL);
+   return addOrIntern(hashTable, data, 1, clone, context);
+}
+
+/* Description: htIntern64 with the hash of data computed by the caller,
+ *    see hashTable64.h.
+ */
+uint64_t htInternHashed64(void *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context)
+{
+   assert(data != NULL && clone != NULL && count > 0);
+   if (!(((HashTable*)hashTable) -> flags & HT_WORDS))
+      hash = rawHash(hashTable, data);
+   return addOrInternHashed(hashTable, data, hash, count, clone, context);
+}
+
+/*
+ * Prefetches the home buckets of a batch, then the first node of each: by
+ * the time the adds walk the chains, most are already in cache. A rehash
+ * during the adds only makes some prefetches useless.
+ */
+static void ht_prefetch(HashTable *hashTable, \
+   const unsigned long long hashes[], int n)
+{
+   HashNode **buckets[HT_BATCH];
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      buckets[i] = homeBucket(hashTable, hashes[i]);
+      __builtin_prefetch(buckets[i]);
+   }
+   for (i = 0; i < n; i++)
+   {
+      if (*buckets[i] != NULL)
+         __builtin_prefetch(*buckets[i]);
+   }
+}
+
+/* Description: Interns a batch of data, see hashTable64.h.
+ */
+void htInternBatch64(void *hashTable, const void *data[], \
+   const unsigned long long hashes[], int n, FNClone clone, void *context, \
+   uint64_t frequencies[])
+{
+   HashTable *ht = (HashTable*)hashTable;
+   unsigned long long own[HT_BATCH];
+   uint64_t freq;
+   int i, start, batch;
+
+   assert(data != NULL && clone != NULL && n >= 0);
+   for (start = 0; start < n; start += batch)
+   {
+      batch = n - start < HT_BATCH ? n - start : HT_BATCH;
+      for (i = 0; i < batch; i++)
+      {
+         assert(data[start + i] != NULL);
+         own[i] = ht -> flags & HT_WORDS ? hashes[start + i] : \
+            rawHash(ht, data[start + i]);
+      }
+      /* HT_CONCURRENT buckets may only be read under their segment's lock */
+      if (ht -> segments == NULL && ht -> flags & HT_OPEN)
+         oaPrefetch(ht, own, batch);
+      else if (ht -> segments == NULL)
+         ht_prefetch(ht, own, batch);
+      for (i = 0; i < batch; i++)
+      {
+         freq = addOrInternHashed(ht, data[start + i], own[i], 1, clone, \
+            context);
+         if (frequencies != NULL)
+            frequencies[start + i] = freq;
+      }
+   }
+}
+
+/* Description: htIntern adding count occurrences, see hashTableExt.h.
+ */
+unsigned htInternCount(void *hashTable, const void *data, unsigned count, \
+   FNClone clone, void *context)
+{
+   return saturate(htInternCount64(hashTable, data, count, clone, context));
+}
+
+uint64_t htInternCount64(void *hashTable, const void *data, uint64_t count, \
+   FNClone clone, void *context)
+{
+   assert(data != NULL && clone != NULL && count > 0);
+   return addOrIntern(hashTable, data, count, clone, context);
+}
+
+/*
+ * Returns the frequency field of data, or NULL, without rehashing, migrating
+ * or otherwise modifying the table. stored is set to the stored data.
+ */
+uint64_t* findFrequency(HashTable *hashTable, const void *data, \
+   unsigned long long raw_hash, void **stored)
+{
+   HashNode *the_node;
+   int words = hashTable -> flags & HT_WORDS;
+   uint64_t probes = 0, compares = 0;
+
+   if (hashTable -> flags & HT_OPEN)
+      return oaFindFrequency(hashTable, data, raw_hash, stored);
+   for (the_node = *homeBucket(hashTable, raw_hash); the_node != NULL; \
+      the_node = the_node -> next)
+   {
+      probes++;
+      if (the_node -> hash == raw_hash && (compares++, \
+         nodeEqual(hashTable, the_node, data, words)))
+      {
+         countProbes(hashTable, probes, compares);
+         *stored = nodeData(the_node, words);
+         return &the_node -> frequency;
+      }
+   }
+   countProbes(hashTable, probes, compares);
+   return NULL;
+}
+
 /* Description: Determines if the data is in the hash table or not.
  * 
  * Notes:
@@ -303,26 +589,45 @@ unsigned htAdd(void *hashTable, void *data)
  */
 HTEntry htLookUp(void *hashTable, void *data)
 {
-   HashNode *the_node;
+   HTEntry64 found = htLookUp64(hashTable, data);
    HTEntry the_entry;
-   unsigned true_hash;
-   HTFunctions *theFunctions = ((HashTable*)hashTable) -> theFunctions;
+
+   the_entry.data = found.data;
+   the_entry.frequency = saturate(found.frequency);
+   return the_entry;
+}
+
+HTEntry64 htLookUp64(void *hashTable, const void *data)
+{
+   HashNode *the_node;
+   HTEntry64 the_entry;
+   unsigned long long true_hash;
+   int words = ((HashTable*)hashTable) -> flags & HT_WORDS;
+   uint64_t probes = 0, compares = 0;
 
    assert(data != NULL);
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccLookUp(hashTable, data);
+   if (((HashTable*)hashTable) -> flags & HT_OPEN)
+      return oaLookUp(hashTable, data);
    the_entry.data = NULL;
    the_entry.frequency = 0;
-   true_hash = (theFunctions -> hash)(data) % htCapacity(hashTable);
-   the_node = (((HashTable*)hashTable) -> theArray)[true_hash];
+   rehashStep(hashTable, HT_MIGRATE_BUCKETS);
+   true_hash = rawHash(hashTable, data);
+   the_node = *homeBucket(hashTable, true_hash);
    while (the_node != NULL)
    {
-      if ((theFunctions -> compare)(the_node -> data, data) == 0)
+      probes++;
+      if (the_node -> hash == true_hash && (compares++, \
+         nodeEqual(hashTable, the_node, data, words)))
       {
-         the_entry.data = the_node -> data;
+         the_entry.data = nodeData(the_node, words);
          the_entry.frequency = the_node -> frequency;
-         return the_entry;
+         break;
       }
       the_node = the_node -> next;
    }
+   countProbes(hashTable, probes, compares);
    return the_entry;
 }
 
@@ -343,13 +648,15 @@ HTEntry htLookUp(void *hashTable, void *data)
  * Return: A dynamically allocated array with all of the hash table entries or
  *    NULL if the hash table is empty (note that free can be called on NULL).
  */
-void htToArrayHelper(void *hashTable, int i, int *j, HTEntry *entryArray)
+void htToArrayHelper(void *hashTable, uint64_t i, uint64_t *j, \
+   HTEntry64 *entryArray)
 {
    HashNode *current = (((HashTable*)hashTable) -> theArray)[i];
+   int words = ((HashTable*)hashTable) -> flags & HT_WORDS;
 
    while (current != NULL)
    {
-      entryArray[*j].data = current -> data;
+      entryArray[*j].data = nodeData(current, words);
       entryArray[*j].frequency = current -> frequency;
       (*j)++;
       current = current -> next;
@@ -358,11 +665,36 @@ void htToArrayHelper(void *hashTable, int i, int *j, HTEntry *entryArray)
 
 HTEntry* htToArray(void *hashTable, unsigned *size)
 {
-   int i, j = 0;
-   unsigned unique_count = htUniqueEntries(hashTable);
-   unsigned capacity = htCapacity(hashTable);
-   HTEntry *entryArray;
+   uint64_t i, size64;
+   HTEntry64 *entries = htToArray64(hashTable, &size64);
+   HTEntry *entryArray = NULL;
+
+   /* An array of more than UINT_MAX entries cannot be described by size */
+   assert(size64 <= UINT_MAX);
+   *size = size64;
+   if (entries != NULL)
+   {
+      entryArray = malloc(size64 * sizeof(HTEntry));
+      alloc_message(entryArray);
+   }
+   for (i = 0; i < size64; i++)
+   {
+      entryArray[i].data = entries[i].data;
+      entryArray[i].frequency = saturate(entries[i].frequency);
+   }
+   free(entries);
+   return entryArray;
+}
+
+HTEntry64* htToArray64(void *hashTable, uint64_t *size)
+{
+   uint64_t i, j = 0;
+   uint64_t unique_count = htUniqueEntries64(hashTable);
+   uint64_t capacity;
+   HTEntry64 *entryArray;
 
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccToArray(hashTable, size);
    *size = unique_count;
 
    if (unique_count == 0)
@@ -370,13 +702,120 @@ HTEntry* htToArray(void *hashTable, unsigned *size)
       entryArray = NULL;
       return entryArray;
    }
-   entryArray = calloc(unique_count, sizeof(HTEntry));
+   entryArray = calloc(unique_count, sizeof(HTEntry64));
    alloc_message(entryArray);
-   for (i = 0; i < capacity; i++)
-      htToArrayHelper(hashTable, i, &j, entryArray);
+   rehashStep(hashTable, UINT64_MAX);
+   capacity = htCapacity64(hashTable);
+   if (((HashTable*)hashTable) -> flags & HT_OPEN)
+      oaToArray(hashTable, entryArray);
+   else
+   {
+      for (i = 0; i < capacity; i++)
+         htToArrayHelper(hashTable, i, &j, entryArray);
+   }
    return entryArray;
 }
 
+/* Description: Visits every entry, see hashTableExt.h.
+ */
+void htForEachHelper(HashNode **nodeArray, uint64_t capacity, int words, \
+   FNVisit64 visit, void *context)
+{
+   uint64_t i;
+   HashNode *current;
+   HTEntry64 the_entry;
+
+   for (i = 0; nodeArray != NULL && i < capacity; i++)
+   {
+      for (current = nodeArray[i]; current != NULL; current = current -> next)
+      {
+         the_entry.data = nodeData(current, words);
+         the_entry.frequency = current -> frequency;
+         visit(the_entry, context);
+      }
+   }
+}
+
+/*
+ * htForEach runs on htForEach64, converting every entry on the way.
+ */
+typedef struct
+{
+   FNVisit visit;
+   void *context;
+} HTVisit32;
+
+void htForEachVisit32(HTEntry64 entry, void *context)
+{
+   HTEntry the_entry;
+
+   the_entry.data = entry.data;
+   the_entry.frequency = saturate(entry.frequency);
+   ((HTVisit32*)context) -> visit(the_entry, ((HTVisit32*)context) -> context);
+}
+
+void htForEach(void *hashTable, FNVisit visit, void *context)
+{
+   HTVisit32 visit32;
+
+   visit32.visit = visit;
+   visit32.context = context;
+   htForEach64(hashTable, htForEachVisit32, &visit32);
+}
+
+void htForEach64(void *hashTable, FNVisit64 visit, void *context)
+{
+   HashTable *ht = (HashTable*)hashTable;
+
+   if (ht -> segments != NULL)
+      ccForEach(ht, visit, context);
+   else if (ht -> flags & HT_OPEN)
+      oaForEach(ht, visit, context);
+   else
+   {
+      htForEachHelper(ht -> theArray, htCapacity64(hashTable), \
+         ht -> flags & HT_WORDS, visit, context);
+      htForEachHelper(ht -> oldArray, ht -> oldCapacity, \
+         ht -> flags & HT_WORDS, visit, context);
+   }
+}
+
+/* Description: Returns the arena of an HT_ARENA hash table, see
+ *    hashTableExt.h.
+ */
+Arena* htArena(void *hashTable)
+{
+   return ((HashTable*)hashTable) -> arena;
+}
+
+/* Description: Sets the key prefix function of an HT_OPEN hash table, see
+ *    hashTableExt.h.
+ */
+void htSetPrefix(void *hashTable, FNPrefix prefix)
+{
+   int i;
+   HashTable *ht = (HashTable*)hashTable;
+
+   assert(htUniqueEntries(hashTable) == 0);
+   ht -> prefix = prefix;
+   for (i = 0; ht -> segments != NULL && i < CC_SEGMENTS; i++)
+      htSetPrefix(ht -> segments[i].table, prefix);
+}
+
+/* Description: Sets the 64-bit hash function of a hash table, see
+ *    hashTableExt.h.
+ */
+void htSetHash64(void *hashTable, FNHash64 hash64)
+{
+   int i;
+   HashTable *ht = (HashTable*)hashTable;
+
+   assert(htUniqueEntries(hashTable) == 0);
+   ht -> hash64 = hash64;
+   for (i = 0; ht -> segments != NULL && i < CC_SEGMENTS; i++)
+      htSetHash64(ht -> segments[i].table, hash64);
+}
+
 /* Description: Reports the current capacity of the hash table.
  * 
  * Notes:
@@ -390,7 +829,14 @@ HTEntry* htToArray(void *hashTable, unsigned *size)
  */
 unsigned htCapacity(void *hashTable)
 {
-   return (((HashTable*)hashTable)->theSizes)[((HashTable*)hashTable)-> rehash];
+   return saturate(htCapacity64(hashTable));
+}
+
+uint64_t htCapacity64(void *hashTable)
+{
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccCapacity(hashTable);
+   return ((HashTable*)hashTable) -> capacity;
 }
 
 /* Description: Returns the number of unique entries in the hash table.
@@ -407,6 +853,13 @@ unsigned htCapacity(void *hashTable)
  */
 unsigned htUniqueEntries(void *hashTable)
 {
+   return saturate(htUniqueEntries64(hashTable));
+}
+
+uint64_t htUniqueEntries64(void *hashTable)
+{
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccUniqueEntries(hashTable);
    return ((HashTable*)hashTable) -> unique;
 }
 
@@ -427,9 +880,39 @@ unsigned htUniqueEntries(void *hashTable)
  */
 unsigned htTotalEntries(void *hashTable)
 {
+   return saturate(htTotalEntries64(hashTable));
+}
+
+uint64_t htTotalEntries64(void *hashTable)
+{
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccTotalEntries(hashTable);
    return ((HashTable*)hashTable) -> total;
 }
 
+/* Description: Returns the bytes held by the hash table, see hashTable64.h.
+ */
+uint64_t htFootprint64(void *hashTable)
+{
+   HashTable *ht = (HashTable*)hashTable;
+   uint64_t bytes = sizeof(HashTable) + ht -> sizes * sizeof(uint64_t);
+
+   if (ht -> segments != NULL)
+      return bytes + ccFootprint(ht);
+   if (ht -> flags & HT_OPEN)
+      bytes += htCapacity64(ht) * (sizeof(OASlot) + sizeof(Byte));
+   else
+      bytes += htCapacity64(ht) * sizeof(HashNode*);
+   if (ht -> oldArray != NULL)
+      bytes += ht -> oldCapacity * sizeof(HashNode*);
+   if (ht -> arena != NULL)
+      bytes += ht -> arena -> reserved;
+   else if (!(ht -> flags & HT_OPEN))
+      bytes += ht -> unique * \
+         (ht -> flags & HT_WORDS ? sizeof(WordNode) : sizeof(HashNode));
+   return bytes;
+}
+
 /* Description: Returns various metrics on the hash table to aid in performance
  *    tuning of CPU and memory usage for a particular problem domain.
  * 
@@ -459,8 +942,8 @@ void htMetricsHelper2(HashNode *current, unsigned *this_len)
    }
 }
 
-void htMetricsHelper(void *hashTable, int i, unsigned *num_chains, \
-   unsigned *sum_len, unsigned *max_len)
+void htMetricsHelper(void *hashTable, uint64_t i, unsigned *num_chains, \
+   uint64_t *sum_len, unsigned *max_len)
 {
    HashNode *current;
    unsigned this_len = 0;
@@ -475,13 +958,18 @@ void htMetricsHelper(void *hashTable, int i, unsigned *num_chains, \
 
 HTMetrics htMetrics(void *hashTable)
 {
-   int i;
-   unsigned sum_len = 0;
-   unsigned capacity = htCapacity(hashTable);
+   uint64_t i, sum_len = 0;
+   uint64_t capacity;
    HTMetrics metrics;
 
+   if (((HashTable*)hashTable) -> segments != NULL)
+      return ccMetrics(hashTable);
+   if (((HashTable*)hashTable) -> flags & HT_OPEN)
+      return oaMetrics(hashTable);
    metrics.numberOfChains = 0;
    metrics.maxChainLength = 0;
+   rehashStep(hashTable, UINT64_MAX);
+   capacity = htCapacity64(hashTable);
 
    for (i = 0; i < capacity; i++)
       htMetricsHelper(hashTable, i, &(metrics.numberOfChains), &sum_len, \
@@ -490,3 +978,60 @@ HTMetrics htMetrics(void *hashTable)
 
    return metrics;
 }
+
+/* Description: Turns the counters of htStats on or off, see hashTable64.h.
+ *    The arrays and nodes the table already holds count as allocated.
+ */
+void htSetStats(void *hashTable, int enabled)
+{
+   HashTable *ht = (HashTable*)hashTable;
+
+   if (ht -> segments != NULL)
+   {
+      ccSetStats(ht, enabled);
+      return;
+   }
+   free(ht -> stats);
+   ht -> stats = NULL;
+   if (!enabled)
+      return;
+   ht -> stats = calloc(1, sizeof(HTStats));
+   alloc_message(ht -> stats);
+   ht -> stats -> allocated = htFootprint64(hashTable) - sizeof(HashTable);
+}
+
+/* Description: Returns the counters, footprint and histogram, see
+ *    hashTable64.h.
+ */
+HTStats htStats(void *hashTable)
+{
+   HashTable *ht = (HashTable*)hashTable;
+   HTStats stats;
+   uint64_t i, length, capacity;
+   HashNode *current;
+
+   if (ht -> segments != NULL)
+      return ccStats(ht);
+   if (ht -> stats != NULL)
+      stats = *ht -> stats;
+   else
+      memset(&stats, 0, sizeof(HTStats));
+   memset(stats.histogram, 0, sizeof(stats.histogram));
+   stats.bytes = htFootprint64(hashTable);
+   if (ht -> flags & HT_OPEN)
+   {
+      oaHistogram(ht, stats.histogram);
+      return stats;
+   }
+   rehashStep(hashTable, UINT64_MAX);
+   capacity = htCapacity64(hashTable);
+   for (i = 0; i < capacity; i++)
+   {
+      length = 0;
+      for (current = ht -> theArray[i]; current != NULL; \
+         current = current -> next)
+         length++;
+      (stats.histogram[min(length, HT_HISTOGRAM - 1)])++;
+   }
+   return stats;
+}
@@ -0,0 +1,131 @@
+/* 64-bit counting API. hashTable.h counts and sizes with unsigned, which
+ * wraps past 2^32 tokens, so the 64-bit variants of its functions are
+ * declared here. Every table counts and sizes with uint64_t internally:
+ *
+ *    1. The 64-bit frequency and hash of an entry fill what used to be
+ *       padding, so nodes, slots and entries are the same size as with
+ *       unsigned counters and the common case pays no extra memory.
+ *    2. The 32-bit functions of hashTable.h and hashTableExt.h keep working
+ *       on any table. Values that do not fit saturate at UINT_MAX instead of
+ *       wrapping.
+ */
+#ifndef HASHTABLE64_H
+#define HASHTABLE64_H
+
+#include <stdint.h>
+#include "hashTable.h"
+#include "hashTableExt.h"
+
+/* The type returned by htLookUp64 and htToArray64.
+ */
+typedef struct
+{
+   void *data;
+   uint64_t frequency;
+} HTEntry64;
+
+/* Function type used by htForEach64, see FNVisit.
+ */
+typedef void (*FNVisit64)(HTEntry64 entry, void *context);
+
+/* Description: htCreateEx with a 64-bit sizes array, so capacities beyond
+ *    4294967295 can be reached. Asserts like htCreate.
+ */
+void* htCreate64(HTFunctions *functions, uint64_t sizes[], int numSizes, \
+   float rehashLoadFactor, int flags);
+
+/* Description: htAdd, htIntern and htInternCount with 64-bit counts.
+ *
+ * Return: The frequency of the data in the hash table.
+ */
+uint64_t htAdd64(void *hashTable, void *data);
+uint64_t htIntern64(void *hashTable, const void *data, FNClone clone, \
+   void *context);
+uint64_t htInternCount64(void *hashTable, const void *data, uint64_t count, \
+   FNClone clone, void *context);
+
+/* Description: htInternCount64 given hash, the hashWord64 (see hashWord.h)
+ *    of the Word data, so a caller that hashed the word while reading it
+ *    does not hash it again. Only HT_WORDS tables use hash: others hash
+ *    data with their own function.
+ *
+ * Return: The frequency of the data in the hash table.
+ */
+uint64_t htInternHashed64(void *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context);
+
+/* The number of data htInternBatch64 prefetches at once */
+#define HT_BATCH 32
+
+/* Description: htInternHashed64 of data[0] to data[n - 1] with hashes[0] to
+ *    hashes[n - 1], in that order, HT_BATCH at a time: the table locations
+ *    of a whole batch are computed and prefetched before any is added, so
+ *    the cache misses of a large table overlap instead of each stalling
+ *    its add. hashes may be NULL for tables without HT_WORDS.
+ *
+ *    frequencies, unless NULL, gets the n frequencies the sequential
+ *    htInternHashed64 calls would have returned (a datum repeated within
+ *    a batch counts each time as it would one call at a time).
+ *    HT_CONCURRENT tables are not prefetched.
+ */
+void htInternBatch64(void *hashTable, const void *data[], \
+   const unsigned long long hashes[], int n, FNClone clone, void *context, \
+   uint64_t frequencies[]);
+
+/* Description: htLookUp with a 64-bit frequency.
+ */
+HTEntry64 htLookUp64(void *hashTable, const void *data);
+
+/* Description: htToArray with 64-bit frequencies and size.
+ *
+ * Return: A dynamically allocated array the caller frees, NULL when empty.
+ */
+HTEntry64* htToArray64(void *hashTable, uint64_t *size);
+
+/* Description: htForEach with 64-bit frequencies.
+ */
+void htForEach64(void *hashTable, FNVisit64 visit, void *context);
+
+/* Description: htCapacity, htUniqueEntries and htTotalEntries without
+ *    saturating. O(1) like the 32-bit versions.
+ */
+uint64_t htCapacity64(void *hashTable);
+uint64_t htUniqueEntries64(void *hashTable);
+uint64_t htTotalEntries64(void *hashTable);
+
+/* Operation counts and chain lengths of a hash table, see htStats.
+ */
+#define HT_HISTOGRAM 16
+typedef struct
+{
+   uint64_t rehashes;      /* moves to a bigger size */
+   uint64_t probes;        /* nodes (HT_OPEN: slots) visited by adds and */
+                           /* lookups */
+   uint64_t compares;      /* calls of the compare function */
+   uint64_t allocated;     /* bytes of arrays and nodes ever allocated, */
+                           /* data excluded */
+   uint64_t bytes;         /* htFootprint64 */
+   /* Buckets with a chain of each length, the last one HT_HISTOGRAM - 1 or
+    * longer. HT_OPEN: entries found after each number of probes. */
+   uint64_t histogram[HT_HISTOGRAM];
+} HTStats;
+
+/* Description: Turns the counting of htStats on or off, off by default.
+ *    While off the operations pay a single untaken branch.
+ */
+void htSetStats(void *hashTable, int enabled);
+
+/* Description: Returns the counts accumulated since htSetStats turned them
+ *    on (zero when off) and the current footprint and histogram. Like
+ *    htMetrics it finishes any HT_INCREMENTAL migration and is O(capacity).
+ */
+HTStats htStats(void *hashTable);
+
+/* Description: Returns the bytes of memory the hash table holds: its arrays
+ *    and either its arena (which includes the data cloned into it) or, for
+ *    tables without one, its nodes. Data the caller allocated is not
+ *    counted. O(1) except for HT_CONCURRENT, which sums its segments.
+ */
+uint64_t htFootprint64(void *hashTable);
+
+#endif
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hashTablePriv.h"
+
+/*
+ * HT_CONCURRENT engine: CC_SEGMENTS ordinary hash tables, each behind its own
+ * reader-writer lock. Data is routed to a segment by the top bits of a
+ * multiplicative scramble of its hash (folded to 32 bits), leaving the hash
+ * itself untouched for the segment's own bucket index.
+ *
+ * Read-locked paths never modify a segment's structure; they only add to
+ * frequencies and totals with atomic instructions. Everything else, including
+ * rehashing, happens under the write lock.
+ */
+#define CC_SEGMENT(hash) (((unsigned)((hash) ^ ((hash) >> 32)) * \
+   2654435761u) >> (32 - CC_SEGMENT_BITS))
+
+void ccCreate(HashTable *hashTable, uint64_t sizes[], int numSizes)
+{
+   int i;
+
+   hashTable -> segments = calloc(CC_SEGMENTS, sizeof(CCSegment));
+   alloc_message(hashTable -> segments);
+   for (i = 0; i < CC_SEGMENTS; i++)
+   {
+      pthread_rwlock_init(&hashTable -> segments[i].lock, NULL);
+      hashTable -> segments[i].table = htCreate64(hashTable -> theFunctions, \
+         sizes, numSizes, hashTable -> loadFactor, \
+         hashTable -> flags & ~HT_CONCURRENT);
+   }
+}
+
+void ccDestroy(HashTable *hashTable)
+{
+   int i;
+
+   for (i = 0; i < CC_SEGMENTS; i++)
+   {
+      htDestroy(hashTable -> segments[i].table);
+      pthread_rwlock_destroy(&hashTable -> segments[i].lock);
+   }
+   free(hashTable -> segments);
+}
+
+/*
+ * Write-locks every segment: htToArray and htMetrics may finish an
+ * HT_INCREMENTAL migration, which readers must not see half done.
+ */
+static void cc_lock_all(HashTable *hashTable)
+{
+   int i;
+
+   for (i = 0; i < CC_SEGMENTS; i++)
+      pthread_rwlock_wrlock(&hashTable -> segments[i].lock);
+}
+
+static void cc_unlock_all(HashTable *hashTable)
+{
+   int i;
+
+   for (i = 0; i < CC_SEGMENTS; i++)
+      pthread_rwlock_unlock(&hashTable -> segments[i].lock);
+}
+
+uint64_t ccAdd(HashTable *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context)
+{
+   uint64_t freq, *found;
+   CCSegment *segment = &hashTable -> segments[CC_SEGMENT(hash)];
+   HashTable *table = segment -> table;
+   void *stored;
+
+   pthread_rwlock_rdlock(&segment -> lock);
+   found = findFrequency(table, data, hash, &stored);
+   if (found != NULL)
+   {
+      freq = __atomic_add_fetch(found, count, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&table -> total, count, __ATOMIC_RELAXED);
+      pthread_rwlock_unlock(&segment -> lock);
+      return freq;
+   }
+   pthread_rwlock_unlock(&segment -> lock);
+
+   /* Not found: insert, or count it if another thread inserted it first */
+   pthread_rwlock_wrlock(&segment -> lock);
+   freq = addOrInternHashed(table, data, hash, count, clone, context);
+   pthread_rwlock_unlock(&segment -> lock);
+   return freq;
+}
+
+HTEntry64 ccLookUp(HashTable *hashTable, const void *data)
+{
+   unsigned long long hash = rawHash(hashTable, data);
+   uint64_t *found;
+   CCSegment *segment = &hashTable -> segments[CC_SEGMENT(hash)];
+   HTEntry64 the_entry;
+   void *stored;
+
+   the_entry.data = NULL;
+   the_entry.frequency = 0;
+   pthread_rwlock_rdlock(&segment -> lock);
+   found = findFrequency(segment -> table, data, hash, &stored);
+   if (found != NULL)
+   {
+      the_entry.data = stored;
+      the_entry.frequency = __atomic_load_n(found, __ATOMIC_RELAXED);
+   }
+   pthread_rwlock_unlock(&segment -> lock);
+   return the_entry;
+}
+
+HTEntry64* ccToArray(HashTable *hashTable, uint64_t *size)
+{
+   int i;
+   uint64_t n;
+   HTEntry64 *entryArray = NULL, *part;
+
+   cc_lock_all(hashTable);
+   for (i = 0, *size = 0; i < CC_SEGMENTS; i++)
+      *size += htUniqueEntries64(hashTable -> segments[i].table);
+   if (*size > 0)
+   {
+      entryArray = malloc(*size * sizeof(HTEntry64));
+      alloc_message(entryArray);
+   }
+   for (i = 0, *size = 0; i < CC_SEGMENTS; i++)
+   {
+      part = htToArray64(hashTable -> segments[i].table, &n);
+      if (n > 0)
+         memcpy(entryArray + *size, part, n * sizeof(HTEntry64));
+      *size += n;
+      free(part);
+   }
+   cc_unlock_all(hashTable);
+   return entryArray;
+}
+
+void ccForEach(HashTable *hashTable, FNVisit64 visit, void *context)
+{
+   int i;
+
+   cc_lock_all(hashTable);
+   for (i = 0; i < CC_SEGMENTS; i++)
+      htForEach64(hashTable -> segments[i].table, visit, context);
+   cc_unlock_all(hashTable);
+}
+
+/*
+ * Sums a per-segment value, read-locking each segment in turn.
+ */
+static uint64_t cc_sum(HashTable *hashTable, uint64_t (*value)(void*))
+{
+   int i;
+   uint64_t sum = 0;
+   CCSegment *segment;
+
+   for (i = 0; i < CC_SEGMENTS; i++)
+   {
+      segment = &hashTable -> segments[i];
+      pthread_rwlock_rdlock(&segment -> lock);
+      sum += value(segment -> table);
+      pthread_rwlock_unlock(&segment -> lock);
+   }
+   return sum;
+}
+
+static uint64_t cc_total(void *table)
+{
+   return __atomic_load_n(&((HashTable*)table) -> total, __ATOMIC_RELAXED);
+}
+
+uint64_t ccCapacity(HashTable *hashTable)
+{
+   return cc_sum(hashTable, htCapacity64);
+}
+
+uint64_t ccUniqueEntries(HashTable *hashTable)
+{
+   return cc_sum(hashTable, htUniqueEntries64);
+}
+
+uint64_t ccTotalEntries(HashTable *hashTable)
+{
+   return cc_sum(hashTable, cc_total);
+}
+
+uint64_t ccFootprint(HashTable *hashTable)
+{
+   return CC_SEGMENTS * sizeof(CCSegment) + cc_sum(hashTable, htFootprint64);
+}
+
+HTMetrics ccMetrics(HashTable *hashTable)
+{
+   int i;
+   double sum = 0, weight, weights = 0;
+   HTMetrics metrics, part;
+
+   metrics.numberOfChains = 0;
+   metrics.maxChainLength = 0;
+   cc_lock_all(hashTable);
+   for (i = 0; i < CC_SEGMENTS; i++)
+   {
+      if (htUniqueEntries64(hashTable -> segments[i].table) == 0)
+         continue;
+      part = htMetrics(hashTable -> segments[i].table);
+      /* Averages are per chain, or per entry for HT_OPEN probe lengths */
+      weight = hashTable -> flags & HT_OPEN ? \
+         htUniqueEntries64(hashTable -> segments[i].table) : \
+         part.numberOfChains;
+      metrics.numberOfChains += part.numberOfChains;
+      sum += (double)part.avgChainLength * weight;
+      weights += weight;
+      if (part.maxChainLength > metrics.maxChainLength)
+         metrics.maxChainLength = part.maxChainLength;
+   }
+   cc_unlock_all(hashTable);
+   metrics.avgChainLength = (float)(sum / weights);
+   return metrics;
+}
+
+void ccSetStats(HashTable *hashTable, int enabled)
+{
+   int i;
+
+   cc_lock_all(hashTable);
+   for (i = 0; i < CC_SEGMENTS; i++)
+      htSetStats(hashTable -> segments[i].table, enabled);
+   cc_unlock_all(hashTable);
+}
+
+HTStats ccStats(HashTable *hashTable)
+{
+   int i, j;
+   HTStats stats, part;
+
+   memset(&stats, 0, sizeof(HTStats));
+   cc_lock_all(hashTable);
+   for (i = 0; i < CC_SEGMENTS; i++)
+   {
+      part = htStats(hashTable -> segments[i].table);
+      stats.rehashes += part.rehashes;
+      stats.probes += part.probes;
+      stats.compares += part.compares;
+      stats.allocated += part.allocated;
+      for (j = 0; j < HT_HISTOGRAM; j++)
+         stats.histogram[j] += part.histogram[j];
+   }
+   cc_unlock_all(hashTable);
+   stats.bytes = htFootprint64(hashTable);
+   return stats;
+}
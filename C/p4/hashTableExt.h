@@ -0,0 +1,192 @@
+/* Extensions to the hash table API. hashTable.h may not be modified, so
+ * everything added on top of it is declared here.
+ */
+#ifndef HASHTABLEEXT_H
+#define HASHTABLEEXT_H
+
+#include "hashTable.h"
+#include "arena.h"
+
+/* Flags for htCreateEx.
+ *
+ *    HT_ARENA: Nodes are carved from an arena owned by the hash table and
+ *       htDestroy releases the whole arena at once instead of walking every
+ *       chain. The table DOES NOT free individual data objects and DOES NOT
+ *       call the destroy function: data should be allocated from htArena so
+ *       that it is released together with the nodes.
+ */
+#define HT_ARENA 0x1
+
+/*    HT_OPEN: Open addressing with linear probing instead of separate
+ *       chaining. A dense array of one-byte control tags (7 bits of the hash)
+ *       is probed first and each slot caches the full hash and an optional
+ *       key prefix (see htSetPrefix), so most mismatches are rejected
+ *       without dereferencing the data. The API behaves the same except:
+ *          1. The table never fills beyond OA_MAX_LOAD. When it would and
+ *             there is no next size (or the load factor is 1.0) a next size
+ *             of about twice the capacity is appended to the sizes.
+ *          2. htMetrics reports probe statistics: numberOfChains is the
+ *             number of clusters (runs of occupied slots), maxChainLength
+ *             the longest probe sequence of any entry and avgChainLength the
+ *             average probe length of all entries, where an entry found in
+ *             its home slot has a probe length of 1.
+ */
+#define HT_OPEN 0x2
+#define OA_MAX_LOAD 0.9
+
+/*    HT_INCREMENTAL: Separate chaining only (asserts when combined with
+ *       HT_OPEN). Rehashing allocates the next size but keeps the old array
+ *       live and every htAdd, htIntern and htLookUp then migrates
+ *       HT_MIGRATE_BUCKETS of its buckets, so no single call pays for moving
+ *       the whole table. htCapacity reports the new size as soon as the
+ *       migration starts. htToArray and htMetrics finish any pending
+ *       migration first.
+ */
+#define HT_INCREMENTAL 0x4
+
+/*    HT_CONCURRENT: Thread-safe hash table. Every function may be called
+ *       concurrently from any number of threads, except htDestroy. The table
+ *       is split by hash into CC_SEGMENTS independent tables, each created
+ *       with the remaining flags and guarded by a reader-writer lock:
+ *          1. Counting data that is already present (the common case) only
+ *             takes the segment's read lock and increments the frequency
+ *             atomically, so hot keys are counted in parallel.
+ *          2. New data takes the segment's write lock, which is also the
+ *             only time a segment rehashes. Resizing is per segment, so a
+ *             rehash only blocks the 1/CC_SEGMENTS of the keys it moves.
+ *          3. clone is called under the segment's write lock and must not
+ *             use htArena, which returns NULL for a concurrent table. With
+ *             HT_ARENA each segment keeps its nodes in a private arena and
+ *             data is not freed by htDestroy.
+ *          4. htCapacity reports the sum of the segment capacities.
+ *          5. htToArray and htMetrics lock every segment and return a
+ *             consistent snapshot.
+ */
+#define HT_CONCURRENT 0x8
+#define CC_SEGMENT_BITS 6
+#define CC_SEGMENTS (1 << CC_SEGMENT_BITS)
+#ifndef HT_MIGRATE_BUCKETS
+#define HT_MIGRATE_BUCKETS 64
+#endif
+
+/*    HT_WORDS: The data are Words (see getWord.h). The table hashes them
+ *       with hashWord64 and compares their lengths and bytes itself, both
+ *       inlined into the add and lookup loops instead of called through
+ *       HTFunctions, whose hash and compare (and htSetHash64) are then not
+ *       used. Unless HT_OPEN, the table also stores each new Word and its
+ *       bytes in the entry's node: clone and destroy are not called and
+ *       the data added stays the caller's. The generic API is unchanged.
+ */
+#define HT_WORDS 0x10
+
+/*    HT_BORROW: With HT_WORDS and unless HT_OPEN, a new node keeps the bytes
+ *       pointer of the Word added instead of a copy of its bytes, so the
+ *       bytes must outlive the table (e.g. the words of other tables being
+ *       merged). Other tables borrow through their clone function instead.
+ */
+#define HT_BORROW 0x20
+
+/* Function type for an optional key prefix used by HT_OPEN.
+ *
+ *    FNPrefix: Returns up to 64 bits summarizing data such that equal data
+ *       always have equal prefixes, e.g. the length and first bytes of a key.
+ */
+typedef unsigned long long (*FNPrefix)(const void *data);
+
+/* Description: htCreate with additional flags (a bitwise-or of the HT_*
+ *    values above, 0 behaves exactly like htCreate). Asserts like htCreate.
+ */
+void* htCreateEx(HTFunctions *functions, unsigned sizes[], int numSizes, \
+   float rehashLoadFactor, int flags);
+
+/* Description: Returns the arena of a hash table created with HT_ARENA, for
+ *    allocating data that lives as long as the table, otherwise NULL.
+ */
+Arena* htArena(void *hashTable);
+
+/* Description: Sets the key prefix function of an HT_OPEN hash table. Must
+ *    be called before any data is added. Without one every prefix is 0.
+ */
+void htSetPrefix(void *hashTable, FNPrefix prefix);
+
+/* Function type for an optional 64-bit hash.
+ *
+ *    FNHash64: FNHash with a 64-bit result, see hashWord.h for Words.
+ */
+typedef unsigned long long (*FNHash64)(const void *data);
+
+/* Description: Makes the hash table hash with hash64 instead of the FNHash
+ *    given to htCreate, which is then no longer called. Must be called before
+ *    any data is added.
+ *
+ * Notes:
+ *    1. All 64 bits are kept with every entry: bucket (and HT_OPEN slot)
+ *       indexes are hash % capacity when rehashing as well as when adding,
+ *       and entries whose 64-bit hashes differ are rejected without calling
+ *       compare.
+ *    2. Without it the same holds for the 32-bit FNHash value.
+ */
+void htSetHash64(void *hashTable, FNHash64 hash64);
+
+/* Function type used by htIntern to make an owned copy of borrowed data.
+ *
+ *    FNClone: Returns a dynamically allocated copy of data that the hash
+ *       table can keep (and free in htDestroy). context is passed through
+ *       unchanged from htIntern.
+ */
+typedef void* (*FNClone)(const void *data, void *context);
+
+/* Description: Lookup-or-insert. Counts data exactly like htAdd but the data
+ *    is only borrowed: when it is already in the hash table its frequency is
+ *    incremented and nothing is stored, when it is new clone is called once
+ *    and the copy it returns is stored instead.
+ *
+ * Notes:
+ *    1. The function is expected to have O(1) performance and hashes and
+ *       probes the table only once.
+ *    2. The function asserts (man 3 assert) if data or clone is NULL.
+ *    3. Rehashing follows the same rules as htAdd.
+ *
+ * Parameters:
+ *    hashTable: A pointer returned by htCreate.
+ *    data: The data to count, e.g. a Word on the stack.
+ *    clone: Makes the copy stored for new data.
+ *    context: Passed to clone.
+ *
+ * Return: The frequency of the data in the hash table, 1 for new data.
+ */
+unsigned htIntern(void *hashTable, const void *data, FNClone clone, \
+   void *context);
+
+/* Description: htIntern for data that occurred count (1 or more) times, e.g.
+ *    when merging the entries of another hash table. The frequency of the
+ *    data and the table's total both grow by count.
+ *
+ * Return: The frequency of the data in the hash table, count for new data.
+ */
+unsigned htInternCount(void *hashTable, const void *data, unsigned count, \
+   FNClone clone, void *context);
+
+/* Function type used by htForEach.
+ *
+ *    FNVisit: Called with a shallow copy of one entry. The data still belongs
+ *       to the hash table.
+ */
+typedef void (*FNVisit)(HTEntry entry, void *context);
+
+/* Description: Calls visit once for every entry of the hash table, in no
+ *    particular order, without copying the entries into an array first.
+ *
+ * Notes:
+ *    1. O(N) like htToArray. The table must not be modified by visit.
+ *    2. Never rehashes or migrates, so it is safe to use on an HT_INCREMENTAL
+ *       table that is in the middle of a migration.
+ *
+ * Parameters:
+ *    hashTable: A pointer returned by htCreate.
+ *    visit: The function to call.
+ *    context: Passed to visit.
+ */
+void htForEach(void *hashTable, FNVisit visit, void *context);
+
+#endif
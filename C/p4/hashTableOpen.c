@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hashTablePriv.h"
+
+/*
+ * HT_OPEN engine: open addressing with linear probing.
+ *
+ * ctrl holds one byte per slot, 0 for an empty slot, otherwise the high bit
+ * set plus the top 7 bits of the hash. Probing scans ctrl, which packs 64
+ * slots per cache line, and only touches a slot when its tag matches. The
+ * slot's cached hash and prefix are checked next, so the user's compare
+ * function (and therefore the data) is normally only reached on a hit.
+ *
+ * Entries are never removed so no tombstones are needed.
+ */
+#define OA_TAG(hash) ((Byte)(0x80 | ((hash) >> 25)))    /* bits 25 to 31 */
+
+static unsigned long long oa_prefix(HashTable *hashTable, const void *data)
+{
+   return hashTable -> prefix != NULL ? hashTable -> prefix(data) : 0;
+}
+
+static void oa_arrays(uint64_t capacity, Byte **ctrl, OASlot **slots)
+{
+   *ctrl = calloc(capacity, sizeof(Byte));
+   alloc_message(*ctrl);
+   *slots = malloc(capacity * sizeof(OASlot));
+   alloc_message(*slots);
+}
+
+void oaCreate(HashTable *hashTable)
+{
+   oa_arrays(htCapacity64(hashTable), &hashTable -> ctrl, &hashTable -> slots);
+}
+
+void oaDestroy(HashTable *hashTable)
+{
+   uint64_t i, capacity = htCapacity64(hashTable);
+   FNDestroy destroyFunc = hashTable -> theFunctions -> destroy;
+
+   for (i = 0; hashTable -> arena == NULL && i < capacity; i++)
+   {
+      if (hashTable -> ctrl[i] == 0)
+         continue;
+      if (destroyFunc != NULL)
+         destroyFunc(hashTable -> slots[i].data);
+      free(hashTable -> slots[i].data);
+   }
+   free(hashTable -> ctrl);
+   free(hashTable -> slots);
+}
+
+/*
+ * Returns the index of the slot holding data, or of the empty slot where it
+ * belongs.
+ */
+static uint64_t oa_find(HashTable *hashTable, const void *data, \
+   unsigned long long hash, unsigned long long prefix)
+{
+   uint64_t capacity = hashTable -> capacity, home = hash % capacity, i;
+   Byte tag = OA_TAG(hash), *ctrl = hashTable -> ctrl;
+   OASlot *slot;
+   int words = hashTable -> flags & HT_WORDS;
+   uint64_t compares = 0;
+
+   for (i = home; ctrl[i] != 0; )
+   {
+      slot = &hashTable -> slots[i];
+      if (ctrl[i] == tag && slot -> hash == hash && slot -> prefix == prefix)
+      {
+         compares++;
+         if (keysEqual(hashTable, slot -> data, data, words))
+            break;
+      }
+      if (++i == capacity)
+         i = 0;
+   }
+   /* The slots probed are those from home to i */
+   countProbes(hashTable, (i + capacity - home) % capacity + 1, compares);
+   return i;
+}
+
+/*
+ * Appends a size of about twice the last one to the sizes array, rounded up
+ * to a prime. Used when the caller's sizes run out before OA_MAX_LOAD.
+ */
+static void oa_extend_sizes(HashTable *hashTable)
+{
+   uint64_t next = hashTable -> theSizes[hashTable -> sizes - 1] * 2 + 1, d;
+
+   if (next < hashTable -> theSizes[hashTable -> sizes - 1])
+   {
+      fprintf(stderr, "hash table full in %s at %d\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+   }
+   for (d = 3; d <= next / d; d += 2)
+   {
+      if (next % d == 0)
+      {
+         next += 2;
+         d = 1;
+      }
+   }
+   hashTable -> theSizes = realloc(hashTable -> theSizes, \
+      (hashTable -> sizes + 1) * sizeof(uint64_t));
+   alloc_message(hashTable -> theSizes);
+   hashTable -> theSizes[(hashTable -> sizes)++] = next;
+}
+
+static void oa_rehash(HashTable *hashTable)
+{
+   uint64_t i, j, capacity = hashTable -> capacity, newCapacity;
+   Byte *ctrl = hashTable -> ctrl, *newCtrl;
+   OASlot *slots = hashTable -> slots, *newSlots;
+
+   (hashTable -> rehash)++;
+   setCapacity(hashTable);
+   newCapacity = hashTable -> capacity;
+   oa_arrays(newCapacity, &newCtrl, &newSlots);
+   if (hashTable -> stats != NULL)
+      (hashTable -> stats -> rehashes)++;
+   countAllocated(hashTable, newCapacity * (sizeof(OASlot) + sizeof(Byte)));
+   for (i = 0; i < capacity; i++)
+   {
+      if (ctrl[i] == 0)
+         continue;
+      for (j = slots[i].hash % newCapacity; newCtrl[j] != 0; )
+      {
+         if (++j == newCapacity)
+            j = 0;
+      }
+      newCtrl[j] = ctrl[i];
+      newSlots[j] = slots[i];
+   }
+   free(ctrl);
+   free(slots);
+   hashTable -> ctrl = newCtrl;
+   hashTable -> slots = newSlots;
+}
+
+/*
+ * Moves to the next size when htAdd's load factor rule says so, or when one
+ * more entry would exceed OA_MAX_LOAD.
+ */
+void oaGrow(HashTable *hashTable)
+{
+   uint64_t capacity = htCapacity64(hashTable);
+   uint64_t unique = htUniqueEntries64(hashTable);
+   int hasNext = hashTable -> rehash < (unsigned)(hashTable -> sizes - 1);
+
+   if (hasNext && hashTable -> loadFactor < 1 && \
+      (double)unique / capacity > hashTable -> loadFactor)
+      oa_rehash(hashTable);
+   else if (unique + 1 > OA_MAX_LOAD * capacity)
+   {
+      if (!hasNext)
+         oa_extend_sizes(hashTable);
+      oa_rehash(hashTable);
+   }
+}
+
+/*
+ * Prefetches the home ctrl byte and slot of a batch, see htInternBatch64.
+ */
+void oaPrefetch(HashTable *hashTable, const unsigned long long hashes[], \
+   int n)
+{
+   uint64_t home;
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      home = hashes[i] % hashTable -> capacity;
+      __builtin_prefetch(&hashTable -> ctrl[home]);
+      __builtin_prefetch(&hashTable -> slots[home]);
+   }
+}
+
+uint64_t oaAdd(HashTable *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, int *decider, FNClone clone, \
+   void *context)
+{
+   uint64_t i;
+   unsigned long long prefix = oa_prefix(hashTable, data);
+   OASlot *slot;
+
+   i = oa_find(hashTable, data, hash, prefix);
+   slot = &hashTable -> slots[i];
+   if (hashTable -> ctrl[i] != 0)
+   {
+      slot -> frequency += count;
+      hashTable -> total += count;
+      *decider = TRUE;
+      return slot -> frequency;
+   }
+   hashTable -> ctrl[i] = OA_TAG(hash);
+   slot -> data = clone == NULL ? (void*)data : clone(data, context);
+   slot -> prefix = prefix;
+   slot -> hash = hash;
+   slot -> frequency = count;
+   *decider = FALSE;
+   return count;
+}
+
+/*
+ * Returns the frequency field of data, or NULL, without modifying the table.
+ */
+uint64_t* oaFindFrequency(HashTable *hashTable, const void *data, \
+   unsigned long long hash, void **stored)
+{
+   uint64_t i = oa_find(hashTable, data, hash, oa_prefix(hashTable, data));
+
+   if (hashTable -> ctrl[i] == 0)
+      return NULL;
+   *stored = hashTable -> slots[i].data;
+   return &hashTable -> slots[i].frequency;
+}
+
+HTEntry64 oaLookUp(HashTable *hashTable, const void *data)
+{
+   HTEntry64 the_entry;
+   uint64_t i = oa_find(hashTable, data, rawHash(hashTable, data), \
+      oa_prefix(hashTable, data));
+
+   the_entry.data = NULL;
+   the_entry.frequency = 0;
+   if (hashTable -> ctrl[i] != 0)
+   {
+      the_entry.data = hashTable -> slots[i].data;
+      the_entry.frequency = hashTable -> slots[i].frequency;
+   }
+   return the_entry;
+}
+
+void oaToArray(HashTable *hashTable, HTEntry64 *entryArray)
+{
+   uint64_t i, j = 0, capacity = htCapacity64(hashTable);
+
+   for (i = 0; i < capacity; i++)
+   {
+      if (hashTable -> ctrl[i] == 0)
+         continue;
+      entryArray[j].data = hashTable -> slots[i].data;
+      entryArray[j].frequency = hashTable -> slots[i].frequency;
+      j++;
+   }
+}
+
+void oaForEach(HashTable *hashTable, FNVisit64 visit, void *context)
+{
+   uint64_t i, capacity = htCapacity64(hashTable);
+   HTEntry64 the_entry;
+
+   for (i = 0; i < capacity; i++)
+   {
+      if (hashTable -> ctrl[i] == 0)
+         continue;
+      the_entry.data = hashTable -> slots[i].data;
+      the_entry.frequency = hashTable -> slots[i].frequency;
+      visit(the_entry, context);
+   }
+}
+
+HTMetrics oaMetrics(HashTable *hashTable)
+{
+   uint64_t i, probe, capacity = htCapacity64(hashTable);
+   double sum = 0;
+   HTMetrics metrics;
+
+   metrics.numberOfChains = 0;
+   metrics.maxChainLength = 0;
+   for (i = 0; i < capacity; i++)
+   {
+      if (hashTable -> ctrl[i] == 0)
+         continue;
+      if (hashTable -> ctrl[i == 0 ? capacity - 1 : i - 1] == 0)
+         (metrics.numberOfChains)++;
+      probe = (i + capacity - hashTable -> slots[i].hash % capacity) % \
+         capacity + 1;
+      sum += probe;
+      if (probe > metrics.maxChainLength)
+         metrics.maxChainLength = saturate(probe);
+   }
+   metrics.avgChainLength = (float)(sum / htUniqueEntries64(hashTable));
+   return metrics;
+}
+
+/*
+ * htStats: the entries by probe length, as measured by oaMetrics.
+ */
+void oaHistogram(HashTable *hashTable, uint64_t *histogram)
+{
+   uint64_t i, probe, capacity = htCapacity64(hashTable);
+
+   for (i = 0; i < capacity; i++)
+   {
+      if (hashTable -> ctrl[i] == 0)
+         continue;
+      probe = (i + capacity - hashTable -> slots[i].hash % capacity) % \
+         capacity + 1;
+      (histogram[min(probe, HT_HISTOGRAM - 1)])++;
+   }
+}
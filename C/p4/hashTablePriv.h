@@ -0,0 +1,261 @@
+/*
+ * Private to the hash table implementation (hashTable.c and the alternative
+ * engines in hashTable*.c). Users only ever see a void*.
+ */
+#ifndef HASHTABLEPRIV_H
+#define HASHTABLEPRIV_H
+
+#include <pthread.h>
+#include <limits.h>
+#include <string.h>
+#include "hashTableExt.h"
+#include "hashTable64.h"
+#include "getWord.h"
+#include "hashWord.h"
+#include "arena.h"
+
+#define FALSE 0
+#define TRUE  1
+
+/*
+ * Slot of the HT_OPEN engine. The cached hash and key prefix reject most
+ * mismatches without dereferencing data.
+ */
+typedef struct
+{
+   void *data;
+   unsigned long long prefix;
+   unsigned long long hash;
+   uint64_t frequency;
+} OASlot;
+
+/*
+ * Segment of the HT_CONCURRENT engine: an ordinary hash table guarded by its
+ * own reader-writer lock, padded so neighbouring locks do not share a cache
+ * line.
+ */
+typedef struct
+{
+   pthread_rwlock_t lock;
+   void *table;
+   char pad[128 - sizeof(pthread_rwlock_t) - sizeof(void*)];
+} CCSegment;
+
+/*
+ * This is the fundamental type of a hash table using separate
+ * chaining as its collision strategy. It will only be used by the
+ * hash table so it is defined in this private header shared by the
+ * hash table source files.
+ */
+typedef struct node
+{
+   /* Other unspecified fields you deem necessary here... */
+   uint64_t frequency;
+   /* Raw hash, all 64 bits when the table has an FNHash64 */
+   unsigned long long hash;
+   /* The quintisential "next" pointer */
+   struct node *next;
+   void *data;
+} HashNode;
+
+/*
+ * Node of an HT_WORDS chain: a HashNode whose data is the Word itself,
+ * followed by its bytes, allocated as one (under HT_BORROW the bytes are
+ * the caller's instead). Comparing reads the length and bytes pointer
+ * beside the hash instead of following data to a cloned Word, and each
+ * entry is 8 bytes smaller.
+ */
+typedef struct
+{
+   uint64_t frequency;
+   unsigned long long hash;
+   HashNode *next;
+   /* bytes points just past the node, unless HT_BORROW */
+   Word word;
+} WordNode;
+
+/*
+ * This is the structure representing a hash table. It is defined in
+ * this private header so that it is private to the hash table. And,
+ * you will be allocating dynamic memory for one so that you can return
+ * a void* to one from the htCreate "constructor-like" function.
+ *
+ * Notice that theArray is a double-pointer. That is because it is an
+ * array (a pointer) of HashNode pointers!
+ */
+typedef struct
+{
+   /* Other unspecified fields you deem necessary here... */
+   HTFunctions *theFunctions;
+   uint64_t *theSizes;
+   unsigned rehash;
+   /* theSizes[rehash] */
+   uint64_t capacity;
+   uint64_t unique;
+   uint64_t total;
+   float loadFactor;
+   int sizes;
+   int flags;
+   /* Holds the nodes (and the user's data) in HT_ARENA mode, else NULL */
+   Arena *arena;
+   /* The quintessential "hash table", a.k.a., an array of node pointers */
+   HashNode **theArray;
+   /* HT_INCREMENTAL: array being migrated, buckets below migrated moved */
+   HashNode **oldArray;
+   uint64_t oldCapacity;
+   uint64_t migrated;
+   /* HT_OPEN engine, see hashTableOpen.c: theArray is NULL instead */
+   Byte *ctrl;
+   OASlot *slots;
+   FNPrefix prefix;
+   /* Replaces theFunctions -> hash when set, see htSetHash64 */
+   FNHash64 hash64;
+   /* HT_CONCURRENT engine, see hashTableConcurrent.c: CC_SEGMENTS tables */
+   CCSegment *segments;
+   /* Counters of htStats, NULL unless htSetStats turned them on */
+   HTStats *stats;
+} HashTable;
+
+/*
+ * Caches the capacity of theSizes[rehash], to be called whenever rehash
+ * changes.
+ */
+static inline void setCapacity(HashTable *hashTable)
+{
+   hashTable -> capacity = hashTable -> theSizes[hashTable -> rehash];
+}
+
+/*
+ * HT_WORDS equality, the compareData of wf without the ordering.
+ */
+static inline int wordsEqual(const void *a, const void *b)
+{
+   const Word *word1 = a, *word2 = b;
+
+   return word1 -> length == word2 -> length && \
+      memcmp(word1 -> bytes, word2 -> bytes, word1 -> length) == 0;
+}
+
+/*
+ * stored == data for the table: wordsEqual when words (flags & HT_WORDS,
+ * read once per add or lookup), else theFunctions -> compare.
+ */
+static inline int keysEqual(HashTable *hashTable, const void *stored, \
+   const void *data, int words)
+{
+   if (words)
+      return wordsEqual(stored, data);
+   return hashTable -> theFunctions -> compare(stored, data) == 0;
+}
+
+/*
+ * The data of a chained node: words is flags & HT_WORDS, as for keysEqual.
+ */
+static inline void* nodeData(HashNode *node, int words)
+{
+   return words ? (void*)&((WordNode*)node) -> word : node -> data;
+}
+
+/*
+ * keysEqual of a chained node, comparing a WordNode's word inline.
+ */
+static inline int nodeEqual(HashTable *hashTable, HashNode *node, \
+   const void *data, int words)
+{
+   const WordNode *stored = (const WordNode*)node;
+   const Word *word = data;
+
+   if (words)
+      return stored -> word.length == word -> length && \
+         memcmp(stored -> word.bytes, word -> bytes, word -> length) == 0;
+   return hashTable -> theFunctions -> compare(node -> data, data) == 0;
+}
+
+/*
+ * The raw hash of data: theFunctions -> hash widened to 64 bits unless the
+ * table has an FNHash64, or hashWord64 inlined for HT_WORDS. Bucket and slot
+ * indexes are this % capacity.
+ */
+static inline unsigned long long rawHash(HashTable *hashTable, \
+   const void *data)
+{
+   if (hashTable -> flags & HT_WORDS)
+      return hashWordBytes(((const Word*)data) -> bytes, \
+         ((const Word*)data) -> length);
+   if (hashTable -> hash64 != NULL)
+      return hashTable -> hash64(data);
+   return hashTable -> theFunctions -> hash(data);
+}
+
+/*
+ * Counts probes and compares of one add or lookup, and bytes allocated, when
+ * htSetStats is on. Atomically: HT_CONCURRENT looks up under a read lock.
+ */
+static inline void countProbes(HashTable *hashTable, uint64_t probes, \
+   uint64_t compares)
+{
+   if (hashTable -> stats != NULL)
+   {
+      __atomic_add_fetch(&hashTable -> stats -> probes, probes, \
+         __ATOMIC_RELAXED);
+      __atomic_add_fetch(&hashTable -> stats -> compares, compares, \
+         __ATOMIC_RELAXED);
+   }
+}
+
+static inline void countAllocated(HashTable *hashTable, uint64_t bytes)
+{
+   if (hashTable -> stats != NULL)
+      hashTable -> stats -> allocated += bytes;
+}
+
+/*
+ * What the 32-bit API of hashTable.h reports for a 64-bit count.
+ */
+static inline unsigned saturate(uint64_t value)
+{
+   return value > UINT_MAX ? UINT_MAX : (unsigned)value;
+}
+
+void alloc_message(void *pointer);
+uint64_t addOrIntern(void *hashTable, const void *data, uint64_t count, \
+   FNClone clone, void *context);
+uint64_t addOrInternHashed(void *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context);
+uint64_t* findFrequency(HashTable *hashTable, const void *data, \
+   unsigned long long raw_hash, void **stored);
+
+/* HT_OPEN engine, hashTableOpen.c */
+void oaCreate(HashTable *hashTable);
+void oaDestroy(HashTable *hashTable);
+void oaGrow(HashTable *hashTable);
+void oaPrefetch(HashTable *hashTable, const unsigned long long hashes[], \
+   int n);
+uint64_t oaAdd(HashTable *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, int *decider, FNClone clone, \
+   void *context);
+HTEntry64 oaLookUp(HashTable *hashTable, const void *data);
+void oaToArray(HashTable *hashTable, HTEntry64 *entryArray);
+HTMetrics oaMetrics(HashTable *hashTable);
+void oaHistogram(HashTable *hashTable, uint64_t *histogram);
+void oaForEach(HashTable *hashTable, FNVisit64 visit, void *context);
+uint64_t* oaFindFrequency(HashTable *hashTable, const void *data, \
+   unsigned long long hash, void **stored);
+
+/* HT_CONCURRENT engine, hashTableConcurrent.c */
+void ccCreate(HashTable *hashTable, uint64_t sizes[], int numSizes);
+void ccDestroy(HashTable *hashTable);
+uint64_t ccAdd(HashTable *hashTable, const void *data, \
+   unsigned long long hash, uint64_t count, FNClone clone, void *context);
+HTEntry64 ccLookUp(HashTable *hashTable, const void *data);
+HTEntry64* ccToArray(HashTable *hashTable, uint64_t *size);
+uint64_t ccCapacity(HashTable *hashTable);
+uint64_t ccUniqueEntries(HashTable *hashTable);
+uint64_t ccTotalEntries(HashTable *hashTable);
+uint64_t ccFootprint(HashTable *hashTable);
+HTMetrics ccMetrics(HashTable *hashTable);
+void ccSetStats(HashTable *hashTable, int enabled);
+HTStats ccStats(HashTable *hashTable);
+void ccForEach(HashTable *hashTable, FNVisit64 visit, void *context);
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "hashWord.h"
+
+#define HW_CRC32C 0x82F63B78u    /* reflected Castagnoli polynomial */
+
+unsigned long long hashSeed = 0;
+
+void hashSetSeed(unsigned long long seed)
+{
+   hashSeed = seed;
+}
+
+unsigned long long hashRandomSeed(void)
+{
+   unsigned long long seed = 0;
+   int fd = open("/dev/urandom", O_RDONLY);
+
+   if (fd < 0 || read(fd, &seed, sizeof(seed)) != sizeof(seed))
+      seed = (unsigned long long)time(NULL) * HW_K1 ^ (unsigned)getpid();
+   if (fd >= 0)
+      close(fd);
+   return seed;
+}
+
+unsigned long long hashWord64(const void *data)
+{
+   return hashWordBytes(((Word*)data) -> bytes, ((Word*)data) -> length);
+}
+
+unsigned hashWord(const void *data)
+{
+   unsigned long long h = hashWord64(data);
+
+   return (unsigned)(h ^ (h >> 32));
+}
+
+static unsigned hw_crc_bytes(unsigned crc, const Byte *bytes, unsigned length)
+{
+   unsigned i;
+   int bit;
+
+   for (i = 0; i < length; i++)
+   {
+      crc ^= bytes[i];
+      for (bit = 0; bit < 8; bit++)
+         crc = (crc >> 1) ^ (HW_CRC32C & -(crc & 1));
+   }
+   return crc;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+static __attribute__((target("sse4.2"))) unsigned hw_crc_sse42(unsigned crc, \
+   const Byte *bytes, unsigned length)
+{
+   unsigned long long crc64 = crc, block;
+   unsigned i;
+
+   for (i = 0; i + 8 <= length; i += 8)
+   {
+      memcpy(&block, bytes + i, 8);
+      crc64 = _mm_crc32_u64(crc64, block);
+   }
+   for (crc = (unsigned)crc64; i < length; i++)
+      crc = _mm_crc32_u8(crc, bytes[i]);
+   return crc;
+}
+#endif
+
+unsigned hashCrc32c(const void *data)
+{
+   const Byte *bytes = ((Word*)data) -> bytes;
+   unsigned length = ((Word*)data) -> length;
+   unsigned crc = ~(unsigned)(hashSeed ^ (hashSeed >> 32));
+
+#if defined(__x86_64__)
+   if (__builtin_cpu_supports("sse4.2"))
+      return ~hw_crc_sse42(crc, bytes, length);
+#endif
+   return ~hw_crc_bytes(crc, bytes, length);
+}
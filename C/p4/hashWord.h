@@ -0,0 +1,105 @@
+#ifndef HASHWORD_H
+#define HASHWORD_H
+
+/*
+ * Hash functions for Words (see getWord.h), for use as FNHash or, with
+ * htSetHash64, FNHash64.
+ *
+ *    hashWord64: Reads the word 8 bytes at a time, multiplies and rotates
+ *       each block into a 64-bit state and finishes with a full avalanche,
+ *       so every output bit depends on every input bit. hashWord is the same
+ *       value folded to 32 bits.
+ *    hashCrc32c: CRC32C of the word, using the SSE4.2 crc32 instruction 8
+ *       bytes at a time when the CPU has it (checked at runtime), otherwise
+ *       computed bit by bit.
+ *
+ * Both depend on a process-wide seed, 0 until hashSetSeed is called, so that
+ * a random seed makes the bucket of any given word unpredictable.
+ */
+#include <string.h>
+#include "getWord.h"
+
+#define HW_K1 0x9E3779B97F4A7C15ULL
+#define HW_K2 0xC2B2AE3D27D4EB4FULL
+
+/* The seed of hashSetSeed, read by hashWordBytes */
+extern unsigned long long hashSeed;
+
+/* Description: Sets the seed of all the hash functions below. Must be called
+ *    before any hash table using them is created (and before threads are
+ *    started), as changing it changes every hash value.
+ */
+void hashSetSeed(unsigned long long seed);
+
+/* Description: Returns a random seed for hashSetSeed, read from
+ *    /dev/urandom or, when that fails, mixed from the time and process id.
+ */
+unsigned long long hashRandomSeed(void);
+
+static inline unsigned long long hw_rotl(unsigned long long x, int r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * The 64-bit finalizer of MurmurHash3.
+ */
+static inline unsigned long long hw_avalanche(unsigned long long h)
+{
+   h ^= h >> 33;
+   h *= 0xFF51AFD7ED558CCDULL;
+   h ^= h >> 33;
+   h *= 0xC4CEB9FE1A85EC53ULL;
+   h ^= h >> 33;
+   return h;
+}
+
+/*
+ * hashWordBytes in steps, for callers that produce the bytes of a word as
+ * they hash it: hw_start, hw_block for each whole 8 bytes (in memcpy order),
+ * then hw_finish with the rest, the first byte most significant.
+ */
+static inline unsigned long long hw_start(unsigned length)
+{
+   return hashSeed ^ (length * HW_K1);
+}
+
+static inline unsigned long long hw_block(unsigned long long h, \
+   unsigned long long block)
+{
+   h ^= hw_rotl(block * HW_K2, 31) * HW_K1;
+   return hw_rotl(h, 27) * 5 + 0x52DCE729;
+}
+
+static inline unsigned long long hw_finish(unsigned long long h, \
+   unsigned long long tail)
+{
+   h ^= hw_rotl(tail * HW_K2, 31) * HW_K1;
+   return hw_avalanche(h);
+}
+
+/* Description: hashWord64 of the word of length bytes, inline so the hot
+ *    paths that hash every word (HT_WORDS tables) avoid the call.
+ */
+static inline unsigned long long hashWordBytes(const Byte *bytes, \
+   unsigned length)
+{
+   unsigned long long h = hw_start(length), block;
+   unsigned i;
+
+   for (i = 0; i + 8 <= length; i += 8)
+   {
+      memcpy(&block, bytes + i, 8);
+      h = hw_block(h, block);
+   }
+   /* The tail a byte at a time, cheaper than a variable length memcpy */
+   for (block = 0; i < length; i++)
+      block = (block << 8) | bytes[i];
+   return hw_finish(h, block);
+}
+
+unsigned long long hashWord64(const void *data);
+unsigned hashWord(const void *data);
+unsigned hashCrc32c(const void *data);
+
+#endif
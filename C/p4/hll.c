@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "hll.h"
+
+HyperLogLog* hllCreate(void)
+{
+   HyperLogLog *hll = calloc(1, sizeof(HyperLogLog));
+
+   if (hll == NULL)
+   {
+      perror("wf");
+      exit(EXIT_FAILURE);
+   }
+   return hll;
+}
+
+void hllAdd(HyperLogLog *hll, unsigned long long hash)
+{
+   unsigned long long rest = hash << HLL_BITS;
+   Byte rank = rest == 0 ? 64 - HLL_BITS + 1 : __builtin_clzll(rest) + 1;
+   Byte *reg = &hll -> registers[hash >> (64 - HLL_BITS)];
+
+   if (rank > *reg)
+      *reg = rank;
+}
+
+uint64_t hllEstimate(HyperLogLog *hll)
+{
+   double m = 1 << HLL_BITS, sum = 0, estimate;
+   unsigned i, zeros = 0;
+
+   for (i = 0; i < (1 << HLL_BITS); i++)
+   {
+      sum += ldexp(1.0, -hll -> registers[i]);
+      zeros += hll -> registers[i] == 0;
+   }
+   estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+   /* Small range correction: linear counting */
+   if (estimate <= 2.5 * m && zeros > 0)
+      estimate = m * log(m / zeros);
+   return (uint64_t)(estimate + 0.5);
+}
+
+void hllDestroy(HyperLogLog *hll)
+{
+   free(hll);
+}
@@ -0,0 +1,34 @@
+#ifndef HLL_H
+#define HLL_H
+
+/*
+ * HyperLogLog: 2^HLL_BITS registers estimate the number of distinct 64-bit
+ * hashes added, with a standard error of about 1.04 / sqrt(2^HLL_BITS), in
+ * 2^HLL_BITS bytes. The first HLL_BITS bits of a hash select a register,
+ * which keeps the largest position of the first 1 bit among the rest.
+ */
+#include <stdint.h>
+#include "getWord.h"
+
+#define HLL_BITS 14
+
+typedef struct
+{
+   Byte registers[1 << HLL_BITS];
+} HyperLogLog;
+
+/* Description: Creates an empty HyperLogLog. Exits with a message when out
+ *    of memory.
+ */
+HyperLogLog* hllCreate(void);
+
+void hllAdd(HyperLogLog *hll, unsigned long long hash);
+
+/* Description: Returns the estimate, corrected by linear counting while
+ *    many registers are still empty.
+ */
+uint64_t hllEstimate(HyperLogLog *hll);
+
+void hllDestroy(HyperLogLog *hll);
+
+#endif
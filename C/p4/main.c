@@ -1,11 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "getWord.h"
 #include "hashTable.h"
+#include "hashTableExt.h"
+#include "hashTable64.h"
 #include "qsortHTEntries.h"
+#include "qsortHTEntriesExt.h"
+#include "topK.h"
+#include "sortHTEntries.h"
+#include "hashWord.h"
+#include "wordSource.h"
+#include "snapshot.h"
+#include "external.h"
+#include "approx.h"
+#include "output.h"
+#include "sizing.h"
 #include "main.h"
+#include "parallel.h"
 
 /*
  * FNV-1a hashing Algorithm. 32-bit mode.
@@ -35,23 +50,23 @@ unsigned hash(const void *data)
    return hash;
 }
 
-static int compareData(const void *a, const void *b)
+int compareData(const void *a, const void *b)
 {
    unsigned lenA = ((Word*)a) -> length, lenB = ((Word*)b) -> length;
    return lenA > lenB ? 1 : (lenA < lenB ? -1 : memcmp(((Word*)a) -> bytes, \
       ((Word*)b) -> bytes, lenA));
 }
 
-FILE* fileOpen(const char *fname)
+int fileOpen(const char *fname)
 {
-   FILE* fp;
-   if ((fp = fopen(fname, "r")) == NULL)
+   int fd;
+   if ((fd = open(fname, O_RDONLY)) < 0)
    {
       fprintf(stderr, "wf: %s: ", fname);
       perror("");
       exit(EXIT_FAILURE);
    }
-   return fp;
+   return fd;
 }
 
 void alloc_exit(void *ptr)
@@ -63,151 +78,714 @@ void alloc_exit(void *ptr)
    }
 }
 
+/*
+ * FNPrefix for the HT_OPEN engine: the length and first 7 bytes of a Word.
+ */
+unsigned long long wordPrefix(const void *data)
+{
+   unsigned long long prefix = 0;
+   unsigned length = ((Word*)data) -> length;
+   memcpy(&prefix, ((Word*)data) -> bytes, min(length, 7));
+   return prefix ^ ((unsigned long long)length << 56);
+}
+
 void print_usage()
 {
-   fprintf(stderr, "Usage: wf [-nX] [file...]\n");
+   fprintf(stderr, "Usage: wf [-nX] [-eENGINE] [-jN] [-hHASH] [-lSNAPSHOT]...");
+   fprintf(stderr, " [-dSNAPSHOT|-DSNAPSHOT] [-M] [-mMEGABYTES]");
+   fprintf(stderr, " [-aEPSILON,DELTA] [-fFORMAT] [--stats[=FILE]]");
+   fprintf(stderr, " [file...]\n");
+   fprintf(stderr, "   ENGINE: chain (default), incr or open\n");
+   fprintf(stderr, "   HASH: word (default), word-random, crc or fnv\n");
+   fprintf(stderr, "   FORMAT: text (default), tsv, json (JSON Lines) or");
+   fprintf(stderr, " binary, the last three\n      with whole words\n");
+   fprintf(stderr, "   -l adds the counts of a snapshot, -d saves the counts");
+   fprintf(stderr, " sorted, -D in table order\n");
+   fprintf(stderr, "   -M merges the -l snapshots into the -d snapshot");
+   fprintf(stderr, " without reading any input\n");
+   fprintf(stderr, "   -m counts in about MEGABYTES (16 or more) of memory,");
+   fprintf(stderr, " spilling sorted runs to $TMPDIR\n");
+   fprintf(stderr, "   -a counts approximately: each count overstates by");
+   fprintf(stderr, " at most the bound printed\n      after it, which is");
+   fprintf(stderr, " within EPSILON * total words with probability\n");
+   fprintf(stderr, "      1 - DELTA, and the unique words are estimated;");
+   fprintf(stderr, " EPSILON is at least 1e-6\n");
+   fprintf(stderr, "   --stats reports the time of each phase and what the");
+   fprintf(stderr, " hash tables did to\n      stderr or FILE\n");
+   fprintf(stderr, "   gzip (and zstd, when built with ZSTD=1) input is");
+   fprintf(stderr, " decompressed\n");
    exit(EXIT_FAILURE);
 }
 
-void check_arg_helper(int argc, char *argv[], int *num_line, int *flg_count)
+void check_engine(const char *engine, Options *opts)
+{
+   opts -> flags &= ~(HT_OPEN | HT_INCREMENTAL);
+   if (strcmp(engine, "open") == 0)
+      opts -> flags |= HT_OPEN;
+   else if (strcmp(engine, "incr") == 0)
+      opts -> flags |= HT_INCREMENTAL;
+   else if (strcmp(engine, "chain") != 0)
+      print_usage();
+}
+
+/*
+ * word-random seeds the hash functions once, before any table exists.
+ */
+void check_hash(const char *name, Options *opts)
+{
+   opts -> hash = hashWord;
+   opts -> hash64 = hashWord64;
+   if (strcmp(name, "word-random") == 0)
+      hashSetSeed(hashRandomSeed());
+   else if (strcmp(name, "crc") == 0)
+   {
+      opts -> hash = hashCrc32c;
+      opts -> hash64 = NULL;
+   }
+   else if (strcmp(name, "fnv") == 0)
+   {
+      opts -> hash = hash;
+      opts -> hash64 = NULL;
+   }
+   else if (strcmp(name, "word") != 0)
+      print_usage();
+}
+
+void check_format(const char *format, Options *opts)
+{
+   if (strcmp(format, "text") == 0)
+      opts -> format = FORMAT_TEXT;
+   else if (strcmp(format, "tsv") == 0)
+      opts -> format = FORMAT_TSV;
+   else if (strcmp(format, "json") == 0)
+      opts -> format = FORMAT_JSON;
+   else if (strcmp(format, "binary") == 0)
+      opts -> format = FORMAT_BINARY;
+   else
+      print_usage();
+}
+
+void check_option(char *arg, Options *opts)
+{
+   int megabytes;
+
+   switch (arg[1])
+   {
+      case 'n':
+         if (sscanf(arg, "-n%d", &opts -> num_line) != 1)
+            print_usage();
+         break;
+      case 'e':
+         check_engine(arg + 2, opts);
+         break;
+      case 'h':
+         check_hash(arg + 2, opts);
+         break;
+      case 'l':
+         if (opts -> numLoad == MAX_SNAPSHOTS || arg[2] == '\0')
+            print_usage();
+         opts -> load[(opts -> numLoad)++] = arg + 2;
+         break;
+      case 'd':
+      case 'D':
+         if (arg[2] == '\0')
+            print_usage();
+         opts -> dump = arg + 2;
+         opts -> dumpSorted = arg[1] == 'd';
+         break;
+      case 'm':
+         if (sscanf(arg, "-m%d", &megabytes) != 1 || \
+            megabytes < EC_MIN_MEGABYTES)
+            print_usage();
+         opts -> budget = (uint64_t)megabytes << 20;
+         break;
+      case 'a':
+         if (sscanf(arg, "-a%lf,%lf", &opts -> epsilon, &opts -> delta) != 2 \
+            || !(opts -> epsilon >= AP_MIN_EPSILON && opts -> epsilon < 1) \
+            || !(opts -> delta > 0 && opts -> delta < 1))
+            print_usage();
+         break;
+      case 'M':
+         opts -> mergeOnly = TRUE;
+         break;
+      case 'f':
+         check_format(arg + 2, opts);
+         break;
+      case '-':
+         if (strcmp(arg, "--stats") != 0 && strncmp(arg, "--stats=", 8) != 0)
+            print_usage();
+         if (opts -> stats == NULL)
+            opts -> stats = statsCreate();
+         opts -> statsFile = arg[7] == '=' ? arg + 8 : NULL;
+         break;
+      case 'j':
+         if (sscanf(arg, "-j%d", &opts -> threads) != 1 || \
+            opts -> threads < 1 || opts -> threads > MAX_THREADS)
+            print_usage();
+         break;
+      default:
+         print_usage();
+   }
+}
+
+void check_arg_helper(int argc, char *argv[], Options *opts, int *flg_count)
 {
    int i;
-   char arg0, arg1;
    for (i = 1; i < argc; i++)
    {
-      arg0 = argv[i][0];
-      arg1 = argv[i][1];
-      if (arg0 == '-' && arg1 != 'n')
-         print_usage();
-      else if (arg0 == '-' && arg1 == 'n')
+      if (argv[i][0] == '-')
       {
-         if (sscanf(argv[i], "-n%d", num_line) != 1)
-            print_usage();
+         check_option(argv[i], opts);
          (*flg_count)++;
       }
    }
 }
 
-int check_arg(int argc, char* argv[], int *num_line)
+int check_arg(int argc, char* argv[], Options *opts)
 {
    int flg_count = 0;
 
    if (argc == 1)
       return 0;
-   check_arg_helper(argc, argv, num_line, &flg_count);
-   if ((*num_line) < 1)
+   check_arg_helper(argc, argv, opts, &flg_count);
+   if (opts -> num_line < 1)
+      print_usage();
+   if (opts -> mergeOnly && (opts -> dump == NULL || !opts -> dumpSorted || \
+      flg_count != argc - 1))
+      print_usage();
+   if (opts -> epsilon > 0 && (opts -> dump != NULL || opts -> mergeOnly || \
+      opts -> budget > 0))
       print_usage();
    if (flg_count == (argc - 1))
       return 0;
    return 1;
 }
 
-void freeWord(const void *data)
+/*
+ * FNClone for htIntern: copies a Word borrowed from the WordSource into the
+ * hash table's arena the first time it is seen. The bytes directly follow
+ * the Word header in the same allocation.
+ */
+void* cloneWord(const void *data, void *context)
+{
+   unsigned length = ((Word*)data) -> length;
+   Word *word_struct = arenaAlloc((Arena*)context, sizeof(Word) + length);
+   word_struct -> bytes = (Byte*)(word_struct + 1);
+   word_struct -> length = length;
+   memcpy(word_struct -> bytes, ((Word*)data) -> bytes, length);
+   return word_struct;
+}
+
+/*
+ * FNClone for words read from a snapshot: only the Word header is copied,
+ * the bytes stay in the snapshot mapping, which outlives the table. Chained
+ * HT_WORDS tables do not call it and copy the word into the node instead,
+ * so it only saves the copy for HT_OPEN and the tables of the other hashes.
+ */
+void* borrowWord(const void *data, void *context)
+{
+   Word *word_struct = arenaAlloc((Arena*)context, sizeof(Word));
+   *word_struct = *(Word*)data;
+   return word_struct;
+}
+
+void lookup_add(Byte *word, unsigned length, unsigned long long hash, \
+   void *ht)
 {
-   free(((Word*)data) -> bytes);
+   Word probe;
+
+   probe.bytes = word;
+   probe.length = length;
+   htInternHashed64(ht, &probe, hash, 1, cloneWord, htArena(ht));
 }
 
-void create_add_free(Byte *word, unsigned length, void *ht, int hasPrintable)
+void batch_flush(WordBatch *batch, void *ht)
 {
-   Word *word_struct;
-   if (hasPrintable == TRUE)
+   htInternBatch64(ht, batch -> data, batch -> hashes, batch -> count, \
+      cloneWord, htArena(ht), NULL);
+   batch -> count = 0;
+   batch -> used = 0;
+}
+
+/*
+ * A word too long to ever fit the batch is added on its own, after the
+ * words before it.
+ */
+void batch_add(WordBatch *batch, Byte *word, unsigned length, \
+   unsigned long long hash, void *ht)
+{
+   Word *slot;
+
+   if (batch -> count == HT_BATCH || batch -> used + length > WF_BATCH_BYTES)
+      batch_flush(batch, ht);
+   if (length > WF_BATCH_BYTES)
    {
-      word_struct = malloc(sizeof(Word));
-      alloc_exit(word_struct);
-      word_struct -> bytes = word;
-      word_struct -> length = length;
-      if (htAdd(ht, word_struct) > 1)
-      {
-         freeWord(word_struct);
-         free(word_struct);
-      }
+      lookup_add(word, length, hash, ht);
+      return;
    }
-   else
-      free(word);
+   slot = &batch -> words[batch -> count];
+   slot -> bytes = memcpy(batch -> bytes + batch -> used, word, length);
+   slot -> length = length;
+   batch -> data[batch -> count] = slot;
+   batch -> hashes[(batch -> count)++] = hash;
+   batch -> used += length;
 }
 
-void open_read_helper(FILE *file, Byte **word, unsigned *wordLength, \
-   int *hasPrintable, void *ht)
+/*
+ * Words are hashed as they are read: HT_WORDS tables (the default hash)
+ * take the hash as is, others hash the word again with their own function.
+ * Once the table reaches WF_BATCH_CAPACITY they are added a batch at a
+ * time, see htInternBatch64.
+ */
+void open_read_helper(WordSource *ws, void *ht)
 {
-   while(EOF != getWord(file, word, wordLength, hasPrintable))
-      create_add_free(*word, *wordLength, ht, *hasPrintable);
-   create_add_free(*word, *wordLength, ht, *hasPrintable);
+   WordBatch batch;
+   Byte *word;
+   unsigned wordLength;
+   unsigned long long hash;
+   uint64_t words = 0;
+   int hasPrintable, batching = FALSE;
+
+   batch.count = 0;
+   batch.used = 0;
+   while (EOF != wsNextHashed(ws, &word, &wordLength, &hasPrintable, &hash))
+   {
+      if (hasPrintable != TRUE)
+         continue;
+      /* Tables only grow: checked every 1024 words until it is reached */
+      if (!batching && (words++ & 1023) == 0)
+         batching = htCapacity64(ht) >= WF_BATCH_CAPACITY;
+      if (batching)
+         batch_add(&batch, word, wordLength, hash, ht);
+      else
+         lookup_add(word, wordLength, hash, ht);
+   }
+   batch_flush(&batch, ht);
+   wsClose(ws);
 }
 
 void open_files(int argc, char *argv[], void *ht)
 {
-   Byte *word = NULL;
-   unsigned wordLength = 0;
-   int i, hasPrintable;
-   FILE *file;
+   int i;
    for (i = 1; i < argc; i++)
    {
       if (argv[i][0] != '-')
-      {
-         file=fileOpen(argv[i]);
-         open_read_helper(file, &word, &wordLength, &hasPrintable, ht);
-         fclose(file);
-      }
+         open_read_helper(wsOpenFd(fileOpen(argv[i])), ht);
    }
 }
 
 void read_stdin(int argc, char *argv[], void *ht)
 {
-   Byte *word = NULL;
-   unsigned wordLength = 0;
-   int hasPrintable;
-   open_read_helper(stdin, &word, &wordLength, &hasPrintable, ht);
+   open_read_helper(wsOpenFd(STDIN_FILENO), ht);
 }
 
-void print_each_helper(HTEntry *entries, int i)
+/*
+ * errors, when not NULL, holds how much each frequency may overstate the
+ * true count, which is printed after it as "(-ERROR)" padded to 12 columns.
+ */
+void print_each_helper(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int i)
 {
-   int j;
-   Byte byte;
-   unsigned length = ((Word*)entries[i].data) -> length;
-   printf("%10d - ", entries[i].frequency);
-   for (j = 0; j < length && j < 30; j++)
+   Word *word = entries[i].data;
+   uint64_t error, width = 4;
+
+   outUint(out, entries[i].frequency, 10);
+   outByte(out, ' ');
+   if (errors != NULL)
    {
-      byte = (((Word*)entries[i].data) -> bytes)[j];
-      if (isprint(byte))
-         printf("%c", byte);
-      else
-         printf(".");
+      for (error = errors[i]; error >= 10; error /= 10)
+         width++;
+      outString(out, "(-");
+      outUint(out, errors[i], 0);
+      outByte(out, ')');
+      for (; width < 12; width++)
+         outByte(out, ' ');
+      outByte(out, ' ');
+   }
+   outString(out, "- ");
+   outPrintable(out, word -> bytes, min(word -> length, 30));
+   if (word -> length > 30)
+      outString(out, "...");
+   outByte(out, '\n');
+}
+
+/*
+ * -ftsv: the count, the error with -a, and the whole word escaped by outTsv.
+ */
+void print_tsv_row(Output *out, HTEntry64 *entries, uint64_t *errors, int i)
+{
+   Word *word = entries[i].data;
+
+   outUint(out, entries[i].frequency, 0);
+   outByte(out, '\t');
+   if (errors != NULL)
+   {
+      outUint(out, errors[i], 0);
+      outByte(out, '\t');
+   }
+   outTsv(out, word -> bytes, word -> length);
+   outByte(out, '\n');
+}
+
+/*
+ * -fjson: one object per line. A word that is not valid UTF-8 cannot be a
+ * JSON string and is given in hex as "bytes" instead of "word".
+ */
+void print_json_row(Output *out, HTEntry64 *entries, uint64_t *errors, int i)
+{
+   Word *word = entries[i].data;
+
+   outString(out, "{\"count\":");
+   outUint(out, entries[i].frequency, 0);
+   if (errors != NULL)
+   {
+      outString(out, ",\"error\":");
+      outUint(out, errors[i], 0);
+   }
+   if (outIsUtf8(word -> bytes, word -> length))
+   {
+      outString(out, ",\"word\":");
+      outJson(out, word -> bytes, word -> length);
    }
-   if (length > 30)
-      printf("...");
-   printf("\n");
+   else
+   {
+      outString(out, ",\"bytes\":\"");
+      outHex(out, word -> bytes, word -> length);
+      outByte(out, '"');
+   }
+   outString(out, "}\n");
 }
 
-void print_each(HTEntry *entries, int num_line, unsigned size)
+/*
+ * -fbinary: the word's length and bytes, then the count and the error with
+ * -a, all lengths and numbers as varints.
+ */
+void print_binary_row(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int i)
+{
+   Word *word = entries[i].data;
+
+   outVarint(out, word -> length);
+   outBytes(out, word -> bytes, word -> length);
+   outVarint(out, entries[i].frequency);
+   if (errors != NULL)
+      outVarint(out, errors[i]);
+}
+
+void print_each(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int num_line, uint64_t size, int format)
 {
+   void (*print_row)(Output*, HTEntry64*, uint64_t*, int) = \
+      format == FORMAT_TSV ? print_tsv_row : \
+      format == FORMAT_JSON ? print_json_row : \
+      format == FORMAT_BINARY ? print_binary_row : print_each_helper;
    int i;
+
    if (size < num_line)
       num_line = size;
    for (i = 0; i < num_line; i++)
-      print_each_helper(entries, i);  
+      print_row(out, entries, errors, i);
 }
 
+/*
+ * What comes before the rows. Text: the unique and total counts, size
+ * prefixed with a ~ when approximate. TSV: the column names. JSON: an object
+ * with the counts. Binary: RANK_MAGIC, the version and flags bytes, then
+ * size, total and the number of rows as varints.
+ */
+void print_header(Output *out, uint64_t size, uint64_t total, \
+   uint64_t rows, int approximate, int format)
+{
+   Byte head[] = {RANK_VERSION, approximate ? RANK_APPROXIMATE : 0};
+
+   switch (format)
+   {
+      case FORMAT_TSV:
+         outString(out, approximate ? "count\terror\tword\n" : \
+            "count\tword\n");
+         break;
+      case FORMAT_JSON:
+         outString(out, "{\"unique\":");
+         outUint(out, size, 0);
+         outString(out, ",\"total\":");
+         outUint(out, total, 0);
+         outString(out, approximate ? ",\"approximate\":true}\n" : \
+            ",\"approximate\":false}\n");
+         break;
+      case FORMAT_BINARY:
+         outString(out, RANK_MAGIC);
+         outBytes(out, head, sizeof(head));
+         outVarint(out, size);
+         outVarint(out, total);
+         outVarint(out, rows);
+         break;
+      default:
+         if (approximate)
+            outByte(out, '~');
+         outUint(out, size, 0);
+         outString(out, " unique words found in ");
+         outUint(out, total, 0);
+         outString(out, " total words\n");
+   }
+}
+
+/*
+ * With opts -> expected, the sizes start where that many words fit.
+ */
+void* createTable(Options *opts)
+{
+   uint64_t s[] = {WF_TABLE_SIZES}, ladder[sizeof(s)/sizeof(uint64_t) + 2];
+   int n = sizeof(s)/sizeof(uint64_t);
+
+   if (opts -> expected > 0)
+      return createTableSizes(opts, ladder, \
+         szLadder(opts -> expected, WF_LOAD_FACTOR, s, n, ladder));
+   return createTableSizes(opts, s, n);
+}
+
+void* createTableSizes(Options *opts, uint64_t sizes[], int numSizes)
+{
+   HTFunctions funcs = {opts -> hash, compareData, NULL};
+   /* The default hash has the table's inlined Word hash and compare */
+   int words = opts -> hash64 == hashWord64 ? HT_WORDS : 0;
+   void *ht = htCreate64(&funcs, sizes, numSizes, WF_LOAD_FACTOR, \
+      opts -> flags | words);
+
+   htSetPrefix(ht, wordPrefix);
+   if (opts -> hash64 != NULL)
+      htSetHash64(ht, opts -> hash64);
+   if (opts -> stats != NULL)
+      htSetStats(ht, TRUE);
+   return ht;
+}
+
+/*
+ * Adds the snapshots to the tables. Several tables are filled like the
+ * shards of pcCount, each word going to table hash % numTables.
+ *
+ * Returns the number of words added.
+ */
+uint64_t load_snapshots(Snapshot **snaps, int numSnaps, void **tables, \
+   int numTables, Options *opts)
+{
+   uint64_t total = 0;
+   void *ht;
+   int i;
+
+   for (i = 0; i < numSnaps; i++)
+   {
+      while (snapNext(snaps[i]))
+      {
+         ht = tables[opts -> hash(&snaps[i] -> word) % numTables];
+         htInternCount64(ht, &snaps[i] -> word, snaps[i] -> frequency, \
+            borrowWord, htArena(ht));
+         total += snaps[i] -> frequency;
+      }
+   }
+   return total;
+}
+
+/*
+ * FNSortEntries for topKTables, context is the Options.
+ */
+void sort_entries(HTEntry64 *entries, uint64_t size, void *context)
+{
+   sortHTEntries(entries, size, ((Options*)context) -> threads);
+}
+
+/*
+ * Prints the top num_line words of the tables, which are selected with a
+ * bounded heap rather than by sorting every unique word.
+ */
+void print_result(void **tables, int numTables, uint64_t total, \
+   Options *opts)
+{
+   int num_line = opts -> num_line, i;
+   uint64_t size = 0, k;
+   HTEntry64 *entries;
+
+   for (i = 0; i < numTables; i++)
+      size += htUniqueEntries64(tables[i]);
+   entries = topKTables(tables, numTables, num_line, compareHTEntries64, \
+      sort_entries, opts, &k);
+   statsPhase(opts -> stats, "rank");
+   print_ranking(entries, k, size, total, opts);
+}
+
+/*
+ * Prints the k ranked entries of a count of size unique words in the -f
+ * format. errors, when not NULL, makes it an -a count.
+ */
+void print_output(HTEntry64 *entries, uint64_t *errors, uint64_t k, \
+   uint64_t size, uint64_t total, Options *opts)
+{
+   Output *out = outOpen(STDOUT_FILENO);
+   uint64_t rows = min(k, (uint64_t)opts -> num_line);
+
+   print_header(out, size, total, rows, errors != NULL, opts -> format);
+   print_each(out, entries, errors, opts -> num_line, k, opts -> format);
+   outClose(out);
+   statsPhase(opts -> stats, "print");
+}
+
+/*
+ * Prints and frees the k ranked entries of a count of size unique words.
+ */
+void print_ranking(HTEntry64 *entries, uint64_t k, uint64_t size, \
+   uint64_t total, Options *opts)
+{
+   print_output(entries, NULL, k, size, total, opts);
+   free(entries);
+}
+
+void approx_read(ApproxCount *ap, WordSource *ws)
+{
+   Word word;
+   int hasPrintable;
+
+   while (EOF != wsNextWord(ws, &word.bytes, &word.length, &hasPrintable))
+   {
+      if (hasPrintable == TRUE)
+         apAdd(ap, &word, 1);
+   }
+   wsClose(ws);
+}
+
+/*
+ * -a: counts into an ApproxCount instead of a hash table. The number of
+ * unique words is an estimate, marked as approximate.
+ */
+void count_approx(int task, int argc, char *argv[], Snapshot **snaps, \
+   Options *opts)
+{
+   ApproxCount *ap = apCreate(opts -> epsilon, opts -> delta, \
+      opts -> num_line);
+   HTEntry64 *entries;
+   uint64_t *errors, k;
+   int i;
+
+   for (i = 0; i < opts -> numLoad; i++)
+   {
+      while (snapNext(snaps[i]))
+         apAdd(ap, &snaps[i] -> word, snaps[i] -> frequency);
+   }
+   for (i = 1; task == 1 && i < argc; i++)
+   {
+      if (argv[i][0] != '-')
+         approx_read(ap, wsOpenFd(fileOpen(argv[i])));
+   }
+   if (task != 1)
+      approx_read(ap, wsOpenFd(STDIN_FILENO));
+   statsPhase(opts -> stats, "count");
+   entries = apTop(ap, opts -> num_line, &errors, &k);
+   statsPhase(opts -> stats, "rank");
+   print_output(entries, errors, k, apUnique(ap), apTotal(ap), opts);
+   free(entries);
+   free(errors);
+   apDestroy(ap);
+}
+
+/*
+ * -m: counts in bounded memory. When nothing had to be spilled the table
+ * holds the whole count and is reported like a serial count.
+ */
+void count_external(int task, int argc, char *argv[], Snapshot **snaps, \
+   Options *opts)
+{
+   ExternalCount ec;
+   HTEntry64 *entries;
+   uint64_t k;
+
+   ecCount(&ec, task, argc, argv, snaps, opts);
+   statsPhase(opts -> stats, "count");
+   if (ec.numRuns == 0)
+   {
+      if (opts -> dump != NULL)
+      {
+         snapDump(&ec.table, 1, opts -> dump, opts -> dumpSorted);
+         statsPhase(opts -> stats, "dump");
+      }
+      print_result(&ec.table, 1, htTotalEntries64(ec.table), opts);
+      statsTables(opts -> stats, &ec.table, 1);
+   }
+   else
+   {
+      entries = ecRank(&ec, &k);
+      statsPhase(opts -> stats, "merge");
+      print_ranking(entries, k, ec.unique, ec.total, opts);
+   }
+   ecDestroy(&ec);
+}
+
+/*
+ * -DWF_NO_MAIN leaves only the functions above, for bench/wfbench.
+ */
+#ifndef WF_NO_MAIN
 int main(int argc, char *argv[])
 {
-   unsigned size;
-   HTEntry *entries;
-   int num_line = DEFAULT, task = check_arg(argc, argv, &num_line);
-   HTFunctions funcs = {hash, compareData, freeWord};
-   unsigned s[] = {
-      359,1579,6949,30577,134581,591901,2604347,11459087,50419883,221847497,
-      976128941,4294967291
-   };
-   void *ht = htCreate(&funcs, s, 26, 0.7);
-
-   if (task == 1)
-      open_files(argc, argv, ht);
+   Options opts = {DEFAULT, HT_ARENA, 1, hashWord, hashWord64};
+   int task = check_arg(argc, argv, &opts);
+   Snapshot *snaps[MAX_SNAPSHOTS];
+   ParallelCount pc;
+   uint64_t total;
+   void *ht;
+   int i;
+
+   for (i = 0; i < opts.numLoad; i++)
+      snaps[i] = snapOpen(opts.load[i]);
+   statsPhase(opts.stats, "open");
+   if (opts.mergeOnly)
+   {
+      snapMerge(snaps, opts.numLoad, opts.dump);
+      statsPhase(opts.stats, "merge");
+   }
+   else if (opts.epsilon > 0)
+      count_approx(task, argc, argv, snaps, &opts);
+   else if (opts.budget > 0)
+      count_external(task, argc, argv, snaps, &opts);
+   else if (task == 1 && opts.threads > 1)
+   {
+      pcCount(&pc, argc, argv, &opts);
+      total = pc.total + \
+         load_snapshots(snaps, opts.numLoad, pc.shards, pc.threads, &opts);
+      statsPhase(opts.stats, "count");
+      if (opts.dump != NULL)
+      {
+         snapDump(pc.shards, pc.threads, opts.dump, opts.dumpSorted);
+         statsPhase(opts.stats, "dump");
+      }
+      print_result(pc.shards, pc.threads, total, &opts);
+      statsTables(opts.stats, pc.tables, pc.threads);
+      statsTables(opts.stats, pc.shards, pc.threads);
+      pcDestroy(&pc);
+   }
    else
-      read_stdin(argc, argv, ht);
-   entries = htToArray(ht, &size);
-   qsortHTEntries(entries, size);
-   printf("%d unique words found in %d total words\n", size,htTotalEntries(ht));
-   print_each(entries, num_line, size);
-   free(entries);
-   htDestroy(ht);
+   {
+      if (task == 1)
+      {
+         opts.expected = szEstimate(argc, argv);
+         statsPhase(opts.stats, "estimate");
+      }
+      ht = createTable(&opts);
+      load_snapshots(snaps, opts.numLoad, &ht, 1, &opts);
+      if (task == 1)
+         open_files(argc, argv, ht);
+      else
+         read_stdin(argc, argv, ht);
+      statsPhase(opts.stats, "count");
+      if (opts.dump != NULL)
+      {
+         snapDump(&ht, 1, opts.dump, opts.dumpSorted);
+         statsPhase(opts.stats, "dump");
+      }
+      print_result(&ht, 1, htTotalEntries64(ht), &opts);
+      statsTables(opts.stats, &ht, 1);
+      htDestroy(ht);
+   }
+   /* Last, the tables borrowed the words of the snapshots */
+   for (i = 0; i < opts.numLoad; i++)
+      snapClose(snaps[i]);
+   statsReport(opts.stats, opts.statsFile);
    return 0;
 }
+#endif
@@ -1,6 +1,16 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <stdint.h>
+#include "getWord.h"
+#include "hashTableExt.h"
+#include "hashTable64.h"
+#include "wordSource.h"
+#include "snapshot.h"
+#include "approx.h"
+#include "output.h"
+#include "stats.h"
+
 /* 
  * task = 0: stdin, no -n
  * task = 1:  file, no -n
@@ -10,22 +20,118 @@
 #define TRUE 1
 #define FALSE 0
 #define DEFAULT 10
+#define MAX_THREADS 256
+#define MAX_SNAPSHOTS 64
+#define WF_LOAD_FACTOR 0.7
+
+/* The sizes of createTable */
+#define WF_TABLE_SIZES \
+   359, 1579, 6949, 30577, 134581, 591901, 2604347, 11459087, 50419883, \
+   221847497, 976128941, 4294967291ULL, 18897856097ULL, 83150566843ULL, \
+   365862494113ULL
+
+/* -fFORMAT */
+#define FORMAT_TEXT 0
+#define FORMAT_TSV 1
+#define FORMAT_JSON 2
+#define FORMAT_BINARY 3
+
+/* Header of -fbinary: RANK_MAGIC, then a version byte and a flags byte */
+#define RANK_MAGIC "WFRANK"
+#define RANK_VERSION 1
+#define RANK_APPROXIMATE 0x1  /* each count is followed by its error */
+
+/* Command line options */
+typedef struct
+{
+   int num_line;     /* -nX */
+   int flags;        /* htCreateEx flags, -eENGINE */
+   int threads;      /* -jN */
+   FNHash hash;      /* -hHASH */
+   FNHash64 hash64;  /* NULL for a 32-bit only hash */
+   const char *load[MAX_SNAPSHOTS];   /* -lSNAPSHOT */
+   int numLoad;
+   const char *dump; /* -dSNAPSHOT (sorted) or -DSNAPSHOT (table order) */
+   int dumpSorted;
+   int mergeOnly;    /* -M */
+   uint64_t budget;  /* -mMEGABYTES in bytes, 0 for no limit */
+   double epsilon, delta;  /* -aEPSILON,DELTA, epsilon 0 for exact counts */
+   int format;       /* -fFORMAT */
+   Stats *stats;     /* --stats[=FILE], else NULL */
+   const char *statsFile;  /* NULL for stderr */
+   uint64_t expected;  /* unique words szEstimate expects, 0 if unknown */
+} Options;
+
+/*
+ * Tables of fewer buckets mostly stay in cache, and batching their words
+ * costs more than the prefetches save
+ */
+#define WF_BATCH_CAPACITY (1 << 18)
+/* Bytes of the words a WordBatch holds */
+#define WF_BATCH_BYTES (HT_BATCH * 32)
+
+/*
+ * Words read ahead for htInternBatch64. A WordSource reuses its buffers, so
+ * the bytes of each word are copied into bytes.
+ */
+typedef struct
+{
+   Word words[HT_BATCH];
+   const void *data[HT_BATCH];
+   unsigned long long hashes[HT_BATCH];
+   Byte bytes[WF_BATCH_BYTES];
+   int count;
+   unsigned used;
+} WordBatch;
 
 unsigned hash(const void *data);
-static int compareData(const void *a, const void *b);
-FILE* fileOpen(const char *fname);
+int compareData(const void *a, const void *b);
+int fileOpen(const char *fname);
 void alloc_exit(void *ptr);
+unsigned long long wordPrefix(const void *data);
 void print_usage();
-void check_arg_helper(int argc, char *argv[], int *num_line, int *flg_count);
-int check_arg(int argc, char* argv[], int *num_line);
-void freeWord(const void *data);
-void create_add_free(Byte *word, unsigned length, void *ht, int hasPrintable);
-void open_read_helper(FILE *file, Byte **word, unsigned *wordLength, \
-   int *hasPrintable, void *ht);
+void check_engine(const char *engine, Options *opts);
+void check_hash(const char *name, Options *opts);
+void check_format(const char *format, Options *opts);
+void check_option(char *arg, Options *opts);
+void check_arg_helper(int argc, char *argv[], Options *opts, int *flg_count);
+int check_arg(int argc, char* argv[], Options *opts);
+void* cloneWord(const void *data, void *context);
+void* borrowWord(const void *data, void *context);
+void lookup_add(Byte *word, unsigned length, unsigned long long hash, \
+   void *ht);
+void batch_flush(WordBatch *batch, void *ht);
+void batch_add(WordBatch *batch, Byte *word, unsigned length, \
+   unsigned long long hash, void *ht);
+void open_read_helper(WordSource *ws, void *ht);
 void open_files(int argc, char *argv[], void *ht);
 void read_stdin(int argc, char *argv[], void *ht);
-void print_each_helper(HTEntry *entries, int i);
-void print_each(HTEntry *entries, int num_line, unsigned size);
+void print_each_helper(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int i);
+void print_tsv_row(Output *out, HTEntry64 *entries, uint64_t *errors, int i);
+void print_json_row(Output *out, HTEntry64 *entries, uint64_t *errors, int i);
+void print_binary_row(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int i);
+void print_each(Output *out, HTEntry64 *entries, uint64_t *errors, \
+   int num_line, uint64_t size, int format);
+void print_header(Output *out, uint64_t size, uint64_t total, \
+   uint64_t rows, int approximate, int format);
+void print_output(HTEntry64 *entries, uint64_t *errors, uint64_t k, \
+   uint64_t size, uint64_t total, Options *opts);
+void* createTable(Options *opts);
+void* createTableSizes(Options *opts, uint64_t sizes[], int numSizes);
+uint64_t load_snapshots(Snapshot **snaps, int numSnaps, void **tables, \
+   int numTables, Options *opts);
+void sort_entries(HTEntry64 *entries, uint64_t size, void *context);
+void print_result(void **tables, int numTables, uint64_t total, \
+   Options *opts);
+void print_ranking(HTEntry64 *entries, uint64_t k, uint64_t size, \
+   uint64_t total, Options *opts);
+void approx_read(ApproxCount *ap, WordSource *ws);
+void count_approx(int task, int argc, char *argv[], Snapshot **snaps, \
+   Options *opts);
+void count_external(int task, int argc, char *argv[], Snapshot **snaps, \
+   Options *opts);
 int main(int argc, char *argv[]);
 
 #endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "output.h"
+
+#define OUT_DIGITS 20    /* of the largest uint64_t */
+#define OUT_VARINT_MAX 10
+
+/* Printable replacement of each byte, and which bytes TSV and JSON escape */
+static Byte outTable[256], outTsvEscape[256], outJsonEscape[256];
+static int outTableReady = 0;
+static const char outHexDigits[] = "0123456789abcdef";
+
+static void out_fail(void)
+{
+   perror("wf");
+   exit(EXIT_FAILURE);
+}
+
+Output* outOpen(int fd)
+{
+   Output *out = malloc(sizeof(Output));
+   int i;
+
+   if (out == NULL || (out -> buffer = malloc(OUT_BUFFER_SIZE)) == NULL)
+      out_fail();
+   out -> fd = fd;
+   out -> used = 0;
+   for (i = 0; !outTableReady && i < 256; i++)
+   {
+      outTable[i] = isprint(i) ? i : '.';
+      outTsvEscape[i] = i < 0x20 || i == 0x7F || i == '\\';
+      outJsonEscape[i] = i < 0x20 || i == '"' || i == '\\';
+   }
+   outTableReady = 1;
+   return out;
+}
+
+/*
+ * Writes all of iov, resuming after short writes and EINTR.
+ */
+static void out_writev(int fd, struct iovec *iov, int count)
+{
+   ssize_t n;
+
+   while (count > 0)
+   {
+      if ((n = writev(fd, iov, count)) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         out_fail();
+      }
+      for (; count > 0 && (size_t)n >= iov -> iov_len; iov++, count--)
+         n -= iov -> iov_len;
+      if (count > 0)
+      {
+         iov -> iov_base = (char*)iov -> iov_base + n;
+         iov -> iov_len -= n;
+      }
+   }
+}
+
+void outFlush(Output *out)
+{
+   struct iovec iov;
+
+   iov.iov_base = out -> buffer;
+   iov.iov_len = out -> used;
+   out_writev(out -> fd, &iov, 1);
+   out -> used = 0;
+}
+
+void outBytes(Output *out, const void *bytes, size_t length)
+{
+   struct iovec iov[2];
+
+   if (length <= OUT_BUFFER_SIZE - out -> used)
+   {
+      memcpy(out -> buffer + out -> used, bytes, length);
+      out -> used += length;
+      return;
+   }
+   iov[0].iov_base = out -> buffer;
+   iov[0].iov_len = out -> used;
+   iov[1].iov_base = (void*)bytes;
+   iov[1].iov_len = length;
+   out_writev(out -> fd, iov, 2);
+   out -> used = 0;
+}
+
+void outString(Output *out, const char *string)
+{
+   outBytes(out, string, strlen(string));
+}
+
+void outByte(Output *out, Byte byte)
+{
+   if (out -> used == OUT_BUFFER_SIZE)
+      outFlush(out);
+   out -> buffer[(out -> used)++] = byte;
+}
+
+void outUint(Output *out, uint64_t value, int width)
+{
+   char digits[OUT_DIGITS + 1];
+   int n = 0;
+
+   do
+   {
+      digits[OUT_DIGITS - n++] = '0' + value % 10;
+      value /= 10;
+   } while (value > 0);
+   for (; width > n; width--)
+      outByte(out, ' ');
+   outBytes(out, digits + OUT_DIGITS + 1 - n, n);
+}
+
+void outPrintable(Output *out, const Byte *bytes, size_t length)
+{
+   size_t i;
+
+   if (length > OUT_BUFFER_SIZE - out -> used)
+      outFlush(out);
+   if (length > OUT_BUFFER_SIZE)
+   {
+      for (i = 0; i < length; i++)
+         outByte(out, outTable[bytes[i]]);
+      return;
+   }
+   for (i = 0; i < length; i++)
+      out -> buffer[out -> used + i] = outTable[bytes[i]];
+   out -> used += length;
+}
+
+void outVarint(Output *out, uint64_t value)
+{
+   Byte bytes[OUT_VARINT_MAX];
+   int n = 0;
+
+   while (value >= 0x80)
+   {
+      bytes[n++] = (Byte)(value | 0x80);
+      value >>= 7;
+   }
+   bytes[n++] = (Byte)value;
+   outBytes(out, bytes, n);
+}
+
+static void out_hex_byte(Output *out, Byte byte)
+{
+   outByte(out, outHexDigits[byte >> 4]);
+   outByte(out, outHexDigits[byte & 0xF]);
+}
+
+static void out_tsv_escape(Output *out, Byte byte)
+{
+   outByte(out, '\\');
+   if (byte == '\\')
+      outByte(out, '\\');
+   else if (byte == '\t')
+      outByte(out, 't');
+   else if (byte == '\n')
+      outByte(out, 'n');
+   else if (byte == '\r')
+      outByte(out, 'r');
+   else
+   {
+      outByte(out, 'x');
+      out_hex_byte(out, byte);
+   }
+}
+
+static void out_json_escape(Output *out, Byte byte)
+{
+   outByte(out, '\\');
+   if (byte == '"' || byte == '\\')
+      outByte(out, byte);
+   else if (byte == '\t')
+      outByte(out, 't');
+   else if (byte == '\n')
+      outByte(out, 'n');
+   else if (byte == '\r')
+      outByte(out, 'r');
+   else
+   {
+      outString(out, "u00");
+      out_hex_byte(out, byte);
+   }
+}
+
+/*
+ * Copies the runs of bytes that need no escaping whole, and passes each of
+ * the others to escape.
+ */
+static void out_escaped(Output *out, const Byte *bytes, size_t length, \
+   const Byte needs[256], void (*escape)(Output*, Byte))
+{
+   size_t start = 0, i;
+
+   for (i = 0; i < length; i++)
+   {
+      if (needs[bytes[i]])
+      {
+         outBytes(out, bytes + start, i - start);
+         escape(out, bytes[i]);
+         start = i + 1;
+      }
+   }
+   outBytes(out, bytes + start, length - start);
+}
+
+void outTsv(Output *out, const Byte *bytes, size_t length)
+{
+   out_escaped(out, bytes, length, outTsvEscape, out_tsv_escape);
+}
+
+void outJson(Output *out, const Byte *bytes, size_t length)
+{
+   outByte(out, '"');
+   out_escaped(out, bytes, length, outJsonEscape, out_json_escape);
+   outByte(out, '"');
+}
+
+void outHex(Output *out, const Byte *bytes, size_t length)
+{
+   size_t i;
+
+   for (i = 0; i < length; i++)
+      out_hex_byte(out, bytes[i]);
+}
+
+int outIsUtf8(const Byte *bytes, size_t length)
+{
+   size_t i = 0, j, more;
+   Byte lead, low, high;
+
+   while (i < length)
+   {
+      if ((lead = bytes[i++]) < 0x80)
+         continue;
+      if (lead < 0xC2 || lead > 0xF4)
+         return 0;
+      more = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : 1;
+      if (length - i < more)
+         return 0;
+      /* The second byte's range rules out overlongs and surrogates */
+      low = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+      high = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+      if (bytes[i] < low || bytes[i] > high)
+         return 0;
+      for (j = 1; j < more; j++)
+      {
+         if ((bytes[i + j] & 0xC0) != 0x80)
+            return 0;
+      }
+      i += more;
+   }
+   return 1;
+}
+
+void outClose(Output *out)
+{
+   outFlush(out);
+   free(out -> buffer);
+   free(out);
+}
@@ -0,0 +1,87 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+/*
+ * Buffered output for wf's results. Rows are formatted straight into a large
+ * buffer, integers by a small hand-rolled formatter and word bytes through a
+ * precomputed printable-byte table, and the buffer goes out with write() once
+ * full, instead of one stdio call per field or byte. Data too large for the
+ * buffer is sent together with it by a single writev().
+ *
+ * Besides the text ranking it encodes words losslessly for the -f formats:
+ * TSV and JSON escaping, and the varints of the binary format.
+ *
+ * Nothing else may write to the same file descriptor while an Output is
+ * open, stdout included: flush stdio before outOpen.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include "getWord.h"
+
+#ifndef OUT_BUFFER_SIZE
+#define OUT_BUFFER_SIZE (1 << 20)
+#endif
+
+typedef struct
+{
+   int fd;
+   Byte *buffer;
+   size_t used;
+} Output;
+
+/* Description: Creates an Output writing to fd. Exits with a message when
+ *    out of memory.
+ */
+Output* outOpen(int fd);
+
+void outBytes(Output *out, const void *bytes, size_t length);
+void outString(Output *out, const char *string);
+void outByte(Output *out, Byte byte);
+
+/* Description: Writes value in decimal, right-aligned in width characters
+ *    like printf's %*llu (width 0 for no padding).
+ */
+void outUint(Output *out, uint64_t value, int width);
+
+/* Description: Writes the bytes, each non-printable one (C locale isprint)
+ *    replaced by '.'.
+ */
+void outPrintable(Output *out, const Byte *bytes, size_t length);
+
+/* Description: Writes value as a little-endian base-128 varint, the
+ *    encoding of snapshot records.
+ */
+void outVarint(Output *out, uint64_t value);
+
+/* Description: Writes the bytes as a TSV field: backslash, tab, newline and
+ *    carriage return become \\, \t, \n and \r, the other control bytes
+ *    \xHH, and every other byte is written as is.
+ */
+void outTsv(Output *out, const Byte *bytes, size_t length);
+
+/* Description: Writes the bytes, which must be valid UTF-8, as a quoted
+ *    JSON string.
+ */
+void outJson(Output *out, const Byte *bytes, size_t length);
+
+/* Description: Writes two lowercase hex digits per byte.
+ */
+void outHex(Output *out, const Byte *bytes, size_t length);
+
+/* Description: Checks that the bytes are well-formed UTF-8 (no overlong
+ *    forms, surrogates or code points past U+10FFFF).
+ *
+ * Return: 1 if they are, 0 otherwise.
+ */
+int outIsUtf8(const Byte *bytes, size_t length);
+
+/* Description: Writes whatever is buffered. Exits with a message when the
+ *    write fails.
+ */
+void outFlush(Output *out);
+
+/* Description: outFlush, then frees out (the fd stays open).
+ */
+void outClose(Output *out);
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hashTableExt.h"
+#include "wordSource.h"
+#include "parallel.h"
+
+typedef struct
+{
+   ParallelCount *pc;
+   int id;
+} PCWorker;
+
+static void* pc_alloc(size_t count, size_t size)
+{
+   void *ptr = calloc(count, size);
+   alloc_exit(ptr);
+   return ptr;
+}
+
+static void pc_add_task(ParallelCount *pc, const char *fname, const Byte *map, \
+   size_t begin, size_t end)
+{
+   PCTask *task = &pc -> tasks[(pc -> numTasks)++];
+
+   task -> fname = fname;
+   task -> map = map;
+   task -> begin = begin;
+   task -> end = end;
+}
+
+/*
+ * Maps a regular file that is large enough to be split, else returns NULL and
+ * leaves the file to be read whole (and any error reported) by a worker.
+ */
+static Byte* pc_map(ParallelCount *pc, const char *fname, size_t *length)
+{
+   struct stat st;
+   int fd;
+   void *map;
+
+   if (stat(fname, &st) != 0 || !S_ISREG(st.st_mode) || \
+      st.st_size < 2 * PC_MIN_RANGE)
+      return NULL;
+   fd = fileOpen(fname);
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return NULL;
+   /* Compressed, the file is one task decompressed by its worker */
+   if (wsCompressed(map, st.st_size))
+   {
+      munmap(map, st.st_size);
+      return NULL;
+   }
+   madvise(map, st.st_size, MADV_SEQUENTIAL);
+   pc -> maps[pc -> numMaps] = map;
+   pc -> mapLengths[(pc -> numMaps)++] = *length = st.st_size;
+   return map;
+}
+
+static void pc_split(ParallelCount *pc, const Byte *map, size_t length)
+{
+   size_t pieces = length / PC_MIN_RANGE, begin = 0, end, i;
+
+   if (pieces > (size_t)pc -> threads)
+      pieces = pc -> threads;
+   for (i = 1; i <= pieces; i++)
+   {
+      end = wsAlignRange(map, length, length / pieces * i);
+      if (i == pieces)
+         end = length;
+      if (end > begin)
+         pc_add_task(pc, NULL, map, begin, end);
+      begin = end;
+   }
+}
+
+static void pc_plan(ParallelCount *pc, int argc, char *argv[])
+{
+   int i, files = 0;
+   size_t length;
+   Byte *map;
+
+   for (i = 1; i < argc; i++)
+      files += argv[i][0] != '-';
+   pc -> tasks = pc_alloc(files * pc -> threads, sizeof(PCTask));
+   pc -> maps = pc_alloc(files, sizeof(Byte*));
+   pc -> mapLengths = pc_alloc(files, sizeof(size_t));
+   for (i = 1; i < argc; i++)
+   {
+      if (argv[i][0] == '-')
+         continue;
+      if (files < pc -> threads && \
+         (map = pc_map(pc, argv[i], &length)) != NULL)
+         pc_split(pc, map, length);
+      else
+         pc_add_task(pc, argv[i], NULL, 0, 0);
+   }
+}
+
+static PCTask* pc_next_task(ParallelCount *pc)
+{
+   PCTask *task = NULL;
+
+   pthread_mutex_lock(&pc -> lock);
+   if (pc -> nextTask < pc -> numTasks)
+      task = &pc -> tasks[(pc -> nextTask)++];
+   pthread_mutex_unlock(&pc -> lock);
+   return task;
+}
+
+/*
+ * Groups a worker's entries by the shard (hash % threads) that merges them.
+ */
+static void pc_partition(ParallelCount *pc, int id)
+{
+   uint64_t i, n, *start;
+   HTEntry64 *entries = htToArray64(pc -> tables[id], &n), *parts;
+   unsigned shard, *shardOf = pc_alloc(n + 1, sizeof(unsigned));
+
+   start = pc -> partStart[id] = pc_alloc(pc -> threads + 1, sizeof(uint64_t));
+   parts = pc -> parts[id] = pc_alloc(n + 1, sizeof(HTEntry64));
+   for (i = 0; i < n; i++)
+   {
+      shardOf[i] = pc -> opts -> hash(entries[i].data) % pc -> threads;
+      start[shardOf[i] + 1]++;
+   }
+   for (shard = 0; shard < (unsigned)pc -> threads; shard++)
+      start[shard + 1] += start[shard];
+   for (i = 0; i < n; i++)
+      parts[start[shardOf[i]]++] = entries[i];
+   for (shard = pc -> threads; shard > 0; shard--)
+      start[shard] = start[shard - 1];
+   start[0] = 0;
+   free(shardOf);
+   free(entries);
+}
+
+static void* pc_worker(void *arg)
+{
+   PCWorker *worker = arg;
+   ParallelCount *pc = worker -> pc;
+   void *ht = pc -> tables[worker -> id] = createTable(pc -> opts);
+   PCTask *task;
+
+   while ((task = pc_next_task(pc)) != NULL)
+   {
+      if (task -> map != NULL)
+         open_read_helper(wsOpenRange(task -> map, task -> begin, \
+            task -> end), ht);
+      else
+         open_read_helper(wsOpenFd(fileOpen(task -> fname)), ht);
+   }
+   pc_partition(pc, worker -> id);
+   return NULL;
+}
+
+/*
+ * FNClone for the shards: the worker tables keep owning the words.
+ */
+static void* pc_borrow(const void *data, void *context)
+{
+   return (void*)data;
+}
+
+static void* pc_merger(void *arg)
+{
+   PCWorker *merger = arg;
+   ParallelCount *pc = merger -> pc;
+   Options shardOpts = *pc -> opts;
+   void *shard;
+   uint64_t i, *start;
+   int w, m = merger -> id;
+
+   /*
+    * HT_ARENA: the shard must never free the borrowed words. HT_WORDS
+    * tables do not call pc_borrow, HT_BORROW makes them borrow too.
+    */
+   shardOpts.flags |= HT_ARENA | HT_BORROW;
+   shard = pc -> shards[m] = createTable(&shardOpts);
+   for (w = 0; w < pc -> threads; w++)
+   {
+      start = pc -> partStart[w];
+      for (i = start[m]; i < start[m + 1]; i++)
+         htInternCount64(shard, pc -> parts[w][i].data, \
+            pc -> parts[w][i].frequency, pc_borrow, NULL);
+   }
+   return NULL;
+}
+
+static void pc_run(ParallelCount *pc, void* (*fn)(void*))
+{
+   int i;
+   pthread_t *threads = pc_alloc(pc -> threads, sizeof(pthread_t));
+   PCWorker *workers = pc_alloc(pc -> threads, sizeof(PCWorker));
+
+   for (i = 0; i < pc -> threads; i++)
+   {
+      workers[i].pc = pc;
+      workers[i].id = i;
+      if (pthread_create(&threads[i], NULL, fn, &workers[i]) != 0)
+      {
+         perror("wf");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (i = 0; i < pc -> threads; i++)
+      pthread_join(threads[i], NULL);
+   free(threads);
+   free(workers);
+}
+
+static void pc_collect(ParallelCount *pc)
+{
+   int i;
+
+   pc -> size = pc -> total = 0;
+   for (i = 0; i < pc -> threads; i++)
+   {
+      pc -> size += htUniqueEntries64(pc -> shards[i]);
+      pc -> total += htTotalEntries64(pc -> tables[i]);
+   }
+}
+
+void pcCount(ParallelCount *pc, int argc, char *argv[], Options *opts)
+{
+   int i;
+
+   memset(pc, 0, sizeof(ParallelCount));
+   pc -> threads = opts -> threads;
+   pc -> opts = opts;
+   pthread_mutex_init(&pc -> lock, NULL);
+   pc -> tables = pc_alloc(pc -> threads, sizeof(void*));
+   pc -> parts = pc_alloc(pc -> threads, sizeof(HTEntry64*));
+   pc -> partStart = pc_alloc(pc -> threads, sizeof(uint64_t*));
+   pc -> shards = pc_alloc(pc -> threads, sizeof(void*));
+   pc_plan(pc, argc, argv);
+   pc_run(pc, pc_worker);
+   for (i = 0; i < pc -> numMaps; i++)
+      munmap(pc -> maps[i], pc -> mapLengths[i]);
+   pc_run(pc, pc_merger);
+   pc_collect(pc);
+}
+
+void pcDestroy(ParallelCount *pc)
+{
+   int i;
+
+   for (i = 0; i < pc -> threads; i++)
+   {
+      htDestroy(pc -> shards[i]);
+      htDestroy(pc -> tables[i]);
+      free(pc -> parts[i]);
+      free(pc -> partStart[i]);
+   }
+   free(pc -> tables);
+   free(pc -> parts);
+   free(pc -> partStart);
+   free(pc -> shards);
+   free(pc -> tasks);
+   free(pc -> maps);
+   free(pc -> mapLengths);
+   pthread_mutex_destroy(&pc -> lock);
+}
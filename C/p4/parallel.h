@@ -0,0 +1,64 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/*
+ * Multithreaded word counting for wf -jN.
+ *
+ * The input files are turned into tasks: whole files when there are at least
+ * as many files as threads, otherwise each large regular file is mapped once
+ * and cut into whitespace-aligned byte ranges. N workers take tasks from a
+ * shared queue and count into their own hash table, then group their entries
+ * by hash into N parts. N mergers each sum one part of every worker into a
+ * shard table, and the shards together hold every unique word exactly once.
+ *
+ * The shards borrow the words from the worker tables, so all tables live
+ * until pcDestroy.
+ */
+#include <pthread.h>
+#include "hashTable.h"
+#include "hashTable64.h"
+#include "getWord.h"
+#include "wordSource.h"
+#include "snapshot.h"
+#include "main.h"
+
+#ifndef PC_MIN_RANGE
+#define PC_MIN_RANGE (4 << 20)    /* smallest byte range worth a task */
+#endif
+
+typedef struct
+{
+   const char *fname;      /* whole file, opened by the worker */
+   const Byte *map;        /* otherwise [begin, end) of a shared mapping */
+   size_t begin, end;
+} PCTask;
+
+typedef struct
+{
+   int threads;
+   Options *opts;
+   PCTask *tasks;
+   int numTasks, nextTask;
+   pthread_mutex_t lock;   /* protects nextTask */
+   Byte **maps;            /* mappings of split files */
+   size_t *mapLengths;
+   int numMaps;
+   void **tables;          /* per worker, own the words */
+   HTEntry64 **parts;      /* per worker, entries grouped by shard */
+   uint64_t **partStart;   /* per worker, threads + 1 offsets into parts */
+   void **shards;          /* per merger, borrow the words */
+   uint64_t size, total;
+} ParallelCount;
+
+/* Description: Counts the words of the file arguments with opts -> threads
+ *    threads. On return the threads shards hold every unique word once and
+ *    size and total hold the same values as htUniqueEntries and
+ *    htTotalEntries of a serial count.
+ */
+void pcCount(ParallelCount *pc, int argc, char *argv[], Options *opts);
+
+/* Description: Frees everything, including the words held by the shards.
+ */
+void pcDestroy(ParallelCount *pc);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "qsortHTEntries.h"
+#include "qsortHTEntriesExt.h"
 #include "getWord.h"
 
 int compareWord(Word *word1, Word *word2)
@@ -32,6 +33,14 @@ int compareHTEntries(const void *entry1, const void *entry2)
       compareWord(((HTEntry*)entry1) -> data, ((HTEntry*)entry2) -> data));
 }
 
+int compareHTEntries64(const void *entry1, const void *entry2)
+{
+   uint64_t freq1 = ((HTEntry64*)entry1) -> frequency;
+   uint64_t freq2 = ((HTEntry64*)entry2) -> frequency;
+   return freq1 > freq2 ? -1 : (freq1 < freq2 ? 1 : \
+      compareWord(((HTEntry64*)entry1) -> data, ((HTEntry64*)entry2) -> data));
+}
+
 void qsortHTEntries(HTEntry *entries, int numberOfEntries)
 {
    qsort(entries, numberOfEntries, sizeof(HTEntry), compareHTEntries);
@@ -0,0 +1,18 @@
+#ifndef QSORTHTENTRIESEXT_H
+#define QSORTHTENTRIESEXT_H
+/*
+ * The compare functions behind qsortHTEntries (qsortHTEntries.h may not be
+ * modified), for code that has to rank entries in exactly the same order:
+ * descending frequency, ties broken by ascending byte-wise word order with
+ * a word sorting before any longer word it is a prefix of.
+ * compareHTEntries64 is the same for HTEntry64.
+ */
+#include "getWord.h"
+#include "hashTable.h"
+#include "hashTable64.h"
+
+int compareWord(Word *word1, Word *word2);
+int compareHTEntries(const void *entry1, const void *entry2);
+int compareHTEntries64(const void *entry1, const void *entry2);
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hll.h"
+#include "wordSource.h"
+#include "sizing.h"
+
+typedef struct
+{
+   HyperLogLog *half, *all;   /* unique words of the even chunks, of all */
+   uint64_t halfBytes, bytes; /* sampled */
+   uint64_t tokens;           /* words sampled */
+} SzSample;
+
+/*
+ * Tried by odd divisors like oa_extend_sizes.
+ */
+uint64_t szPrime(uint64_t n)
+{
+   uint64_t d;
+
+   for (n |= 1, d = 3; d <= n / d; d += 2)
+   {
+      if (n % d == 0)
+      {
+         n += 2;
+         d = 1;
+      }
+   }
+   return n;
+}
+
+/*
+ * Counts the words of the SZ_CHUNK_SIZE bytes at offset, moved forward to
+ * whole words.
+ */
+static void sz_chunk(SzSample *sample, const Byte *map, size_t length, \
+   size_t offset, int half)
+{
+   size_t begin = wsAlignRange(map, length, offset), end = length;
+   unsigned long long hash;
+   WordSource *ws;
+   Byte *word;
+   unsigned wordLength;
+   int hasPrintable;
+
+   if (offset + SZ_CHUNK_SIZE < length)
+      end = wsAlignRange(map, length, offset + SZ_CHUNK_SIZE);
+   if (end <= begin)
+      return;
+   ws = wsOpenRange(map, begin, end);
+   while (EOF != wsNextHashed(ws, &word, &wordLength, &hasPrintable, &hash))
+   {
+      if (!hasPrintable)
+         continue;
+      hllAdd(sample -> all, hash);
+      if (half)
+         hllAdd(sample -> half, hash);
+      (sample -> tokens)++;
+   }
+   wsClose(ws);
+   sample -> bytes += end - begin;
+   if (half)
+      sample -> halfBytes += end - begin;
+}
+
+/*
+ * A file the count will report is skipped, as is one that cannot be mapped.
+ */
+static Byte* sz_map(const char *fname, size_t length)
+{
+   int fd = open(fname, O_RDONLY);
+   void *map;
+
+   if (fd < 0)
+      return NULL;
+   map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   return map == MAP_FAILED ? NULL : map;
+}
+
+/*
+ * The size of a compressed file says little about its words, and sampling
+ * it would need decompressing, so only plain files are sampled.
+ */
+static int sz_plain(const char *fname)
+{
+   Byte head[WS_HEAD_SIZE];
+   int fd = open(fname, O_RDONLY);
+   ssize_t n;
+
+   if (fd < 0)
+      return 0;
+   n = read(fd, head, sizeof(head));
+   close(fd);
+   return n >= 0 && !wsCompressed(head, n);
+}
+
+static int sz_regular(const char *arg, struct stat *st)
+{
+   return arg[0] != '-' && stat(arg, st) == 0 && S_ISREG(st -> st_mode) && \
+      sz_plain(arg);
+}
+
+/*
+ * Heaps' law: unique = K * bytes^beta, beta in [0, 1], from the two samples.
+ */
+static uint64_t sz_extrapolate(SzSample *sample, uint64_t total)
+{
+   double all = hllEstimate(sample -> all), half = hllEstimate(sample -> half);
+   double ratio, scale, beta = 0, unique;
+
+   if (sample -> halfBytes == 0)
+      return 0;
+   ratio = (double)sample -> bytes / sample -> halfBytes;
+   if (ratio <= 1)
+      return 0;
+   scale = (double)total / sample -> bytes;
+   if (half > 0 && all > half)
+      beta = log(all / half) / log(ratio);
+   unique = all * pow(scale, beta < 1 ? beta : 1);
+   if (unique > sample -> tokens * scale)
+      unique = sample -> tokens * scale;
+   return (uint64_t)unique;
+}
+
+uint64_t szEstimate(int argc, char *argv[])
+{
+   SzSample sample = {NULL, NULL, 0, 0, 0};
+   uint64_t total = 0, base = 0, step, offset, estimate;
+   struct stat st;
+   Byte *map;
+   int i, c = 0;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (sz_regular(argv[i], &st))
+         total += st.st_size;
+   }
+   if (total < SZ_MIN_INPUT)
+      return 0;
+   step = total / SZ_CHUNKS;
+   sample.half = hllCreate();
+   sample.all = hllCreate();
+   for (i = 1; i < argc && c < SZ_CHUNKS; i++)
+   {
+      if (!sz_regular(argv[i], &st) || st.st_size == 0)
+         continue;
+      /* Each chunk in the middle of its SZ_CHUNKS-th of the input */
+      offset = c * step + (step - SZ_CHUNK_SIZE) / 2;
+      map = offset < base + st.st_size ? sz_map(argv[i], st.st_size) : NULL;
+      for ( ; c < SZ_CHUNKS && offset < base + st.st_size; c++)
+      {
+         if (map != NULL)
+            sz_chunk(&sample, map, st.st_size, offset - base, c % 2 == 0);
+         offset += step;
+      }
+      if (map != NULL)
+         munmap(map, st.st_size);
+      base += st.st_size;
+   }
+   estimate = sz_extrapolate(&sample, total);
+   hllDestroy(sample.half);
+   hllDestroy(sample.all);
+   return estimate;
+}
+
+int szLadder(uint64_t expected, double loadFactor, const uint64_t sizes[], \
+   int numSizes, uint64_t ladder[])
+{
+   uint64_t first = szPrime((uint64_t)(expected * SZ_HEADROOM / loadFactor));
+   int i, n = 0;
+
+   ladder[n++] = first > sizes[0] ? first : sizes[0];
+   ladder[n] = szPrime(2 * ladder[0]);
+   n++;
+   for (i = 0; i < numSizes; i++)
+   {
+      if (sizes[i] / 2 > ladder[1])
+         ladder[n++] = sizes[i];
+   }
+   return n;
+}
@@ -0,0 +1,46 @@
+#ifndef SIZING_H
+#define SIZING_H
+
+/*
+ * Starting sizes of wf's hash table. Before counting, SZ_CHUNKS evenly
+ * spaced chunks of SZ_CHUNK_SIZE bytes of the input files are tokenized and
+ * the unique words of the even-numbered chunks and of all of them are
+ * counted with HyperLogLogs. Unique words grow about like bytes^beta (Heaps'
+ * law), so the two counts give beta and extrapolate to the whole input, and
+ * the table starts at a size that holds that many words instead of climbing
+ * the sizes one rehash at a time.
+ */
+#include <stdint.h>
+
+#define SZ_CHUNKS 8
+#define SZ_CHUNK_SIZE (256 * 1024)
+/* Smaller inputs are not estimated: their few rehashes cost less */
+#define SZ_MIN_INPUT (4 * SZ_CHUNKS * SZ_CHUNK_SIZE)
+/* Room for the estimate falling short, not to rehash for the last words */
+#define SZ_HEADROOM 1.25
+
+/* Description: Returns the smallest odd prime of at least n, n 3 or more.
+ */
+uint64_t szPrime(uint64_t n);
+
+/* Description: Estimates the number of unique words of the files among
+ *    argv[1] to argv[argc - 1] (the arguments not starting with '-', like
+ *    open_files). Only regular files are sampled.
+ *
+ * Return: The estimate, never more than the estimated number of words, or 0
+ *    when the files total less than SZ_MIN_INPUT bytes.
+ */
+uint64_t szEstimate(int argc, char *argv[]);
+
+/* Description: Writes to ladder the sizes of a table expected to hold
+ *    expected entries at loadFactor: the smallest prime that holds
+ *    SZ_HEADROOM times that many, a prime of about twice that, then the
+ *    sizes (increasing, like WF_TABLE_SIZES) of more than twice that again,
+ *    for when the estimate falls well short.
+ *
+ * Return: The number of sizes written, at most numSizes + 2.
+ */
+int szLadder(uint64_t expected, double loadFactor, const uint64_t sizes[], \
+   int numSizes, uint64_t ladder[]);
+
+#endif
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hashTable64.h"
+#include "qsortHTEntriesExt.h"
+#include "snapshot.h"
+
+#define TRUE 1
+#define FALSE 0
+#define SNAP_BUFFER_SIZE (1 << 20)
+#define SNAP_VARINT_MAX 10    /* bytes of the longest 64-bit varint */
+
+static void* snap_alloc(size_t count, size_t size)
+{
+   void *ptr = malloc(count * size);
+
+   if (ptr == NULL && count > 0)
+   {
+      perror("wf");
+      exit(EXIT_FAILURE);
+   }
+   return ptr;
+}
+
+static void snap_fail(const char *fname, const char *message)
+{
+   fprintf(stderr, "wf: %s: %s\n", fname, message);
+   exit(EXIT_FAILURE);
+}
+
+static void snap_perror(const char *fname)
+{
+   fprintf(stderr, "wf: %s: ", fname);
+   perror("");
+   exit(EXIT_FAILURE);
+}
+
+static uint64_t snap_get64(const Byte *bytes)
+{
+   uint64_t value = 0;
+   int i;
+
+   for (i = 7; i >= 0; i--)
+      value = (value << 8) | bytes[i];
+   return value;
+}
+
+static void snap_put64(Byte *bytes, uint64_t value)
+{
+   int i;
+
+   for (i = 0; i < 8; i++, value >>= 8)
+      bytes[i] = (Byte)value;
+}
+
+Snapshot* snapOpen(const char *fname)
+{
+   Snapshot *snap = snap_alloc(1, sizeof(Snapshot));
+   struct stat st;
+   void *map;
+   int fd;
+
+   if ((fd = open(fname, O_RDONLY)) < 0 || fstat(fd, &st) != 0)
+      snap_perror(fname);
+   if (!S_ISREG(st.st_mode) || st.st_size < SNAP_HEADER_SIZE)
+      snap_fail(fname, "not a snapshot");
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (map == MAP_FAILED)
+      snap_perror(fname);
+   close(fd);
+   madvise(map, st.st_size, MADV_SEQUENTIAL);
+   memset(snap, 0, sizeof(Snapshot));
+   snap -> fname = fname;
+   snap -> map = map;
+   snap -> length = st.st_size;
+   snap -> pos = SNAP_HEADER_SIZE;
+   if (memcmp(map, SNAP_MAGIC, 6) != 0)
+      snap_fail(fname, "not a snapshot");
+   if (snap -> map[6] != SNAP_VERSION)
+      snap_fail(fname, "unsupported snapshot version");
+   snap -> flags = snap -> map[7];
+   snap -> count = snap_get64(snap -> map + 8);
+   snap -> total = snap_get64(snap -> map + 16);
+   return snap;
+}
+
+/*
+ * Decodes the varint at pos. Returns FALSE when it runs past the end of the
+ * mapping or does not fit in 64 bits.
+ */
+static int snap_varint(Snapshot *snap, uint64_t *value)
+{
+   uint64_t result = 0;
+   int shift;
+   Byte byte;
+
+   for (shift = 0; shift < 7 * SNAP_VARINT_MAX; shift += 7)
+   {
+      if (snap -> pos >= snap -> length)
+         return FALSE;
+      byte = snap -> map[(snap -> pos)++];
+      if (shift == 63 && byte > 1)
+         return FALSE;
+      result |= (uint64_t)(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+      {
+         *value = result;
+         return TRUE;
+      }
+   }
+   return FALSE;
+}
+
+int snapNext(Snapshot *snap)
+{
+   uint64_t length;
+
+   if (snap -> read == snap -> count)
+   {
+      if (snap -> pos != snap -> length)
+         snap_fail(snap -> fname, "corrupt snapshot");
+      return FALSE;
+   }
+   if (!snap_varint(snap, &length) || length > UINT_MAX || \
+      length > snap -> length - snap -> pos)
+      snap_fail(snap -> fname, "corrupt snapshot");
+   snap -> word.bytes = snap -> map + snap -> pos;
+   snap -> word.length = (unsigned)length;
+   snap -> pos += length;
+   if (!snap_varint(snap, &snap -> frequency) || snap -> frequency == 0)
+      snap_fail(snap -> fname, "corrupt snapshot");
+   (snap -> read)++;
+   return TRUE;
+}
+
+void snapClose(Snapshot *snap)
+{
+   munmap(snap -> map, snap -> length);
+   free(snap);
+}
+
+SnapWriter* snapCreate(const char *fname, int flags)
+{
+   SnapWriter *writer = snap_alloc(1, sizeof(SnapWriter));
+   Byte header[SNAP_HEADER_SIZE] = {0};
+
+   writer -> fname = fname;
+   writer -> flags = flags;
+   writer -> count = writer -> total = 0;
+   if ((writer -> file = fopen(fname, "wb")) == NULL)
+      snap_perror(fname);
+   setvbuf(writer -> file, NULL, _IOFBF, SNAP_BUFFER_SIZE);
+   /* Rewritten by snapFinish once count and total are known */
+   fwrite(header, 1, SNAP_HEADER_SIZE, writer -> file);
+   return writer;
+}
+
+static void snap_put_varint(FILE *file, uint64_t value)
+{
+   Byte bytes[SNAP_VARINT_MAX];
+   int n = 0;
+
+   while (value >= 0x80)
+   {
+      bytes[n++] = (Byte)(value | 0x80);
+      value >>= 7;
+   }
+   bytes[n++] = (Byte)value;
+   fwrite(bytes, 1, n, file);
+}
+
+void snapWrite(SnapWriter *writer, const Word *word, uint64_t frequency)
+{
+   snap_put_varint(writer -> file, word -> length);
+   fwrite(word -> bytes, 1, word -> length, writer -> file);
+   snap_put_varint(writer -> file, frequency);
+   (writer -> count)++;
+   writer -> total += frequency;
+}
+
+void snapFinish(SnapWriter *writer)
+{
+   Byte header[SNAP_HEADER_SIZE];
+
+   memcpy(header, SNAP_MAGIC, 6);
+   header[6] = SNAP_VERSION;
+   header[7] = (Byte)writer -> flags;
+   snap_put64(header + 8, writer -> count);
+   snap_put64(header + 16, writer -> total);
+   if (fseek(writer -> file, 0, SEEK_SET) != 0 || \
+      fwrite(header, 1, SNAP_HEADER_SIZE, writer -> file) != SNAP_HEADER_SIZE \
+      || ferror(writer -> file) || fclose(writer -> file) != 0)
+      snap_perror(writer -> fname);
+   free(writer);
+}
+
+static int snap_compare_entries(const void *entry1, const void *entry2)
+{
+   return compareWord(((HTEntry64*)entry1) -> data, \
+      ((HTEntry64*)entry2) -> data);
+}
+
+static void snap_visit(HTEntry64 entry, void *context)
+{
+   snapWrite(context, entry.data, entry.frequency);
+}
+
+void snapDump(void **tables, int numTables, const char *fname, int sorted)
+{
+   SnapWriter *writer = snapCreate(fname, sorted ? SNAP_SORTED : 0);
+   HTEntry64 *entries, *part;
+   uint64_t size = 0, n, i;
+   int t;
+
+   if (!sorted)
+   {
+      for (t = 0; t < numTables; t++)
+         htForEach64(tables[t], snap_visit, writer);
+      snapFinish(writer);
+      return;
+   }
+   /* One table is sorted in the array htToArray64 returns, without a copy */
+   if (numTables == 1)
+      entries = htToArray64(tables[0], &size);
+   else
+   {
+      for (t = 0; t < numTables; t++)
+         size += htUniqueEntries64(tables[t]);
+      entries = snap_alloc(size, sizeof(HTEntry64));
+      for (t = 0, size = 0; t < numTables; t++)
+      {
+         if ((part = htToArray64(tables[t], &n)) == NULL)
+            continue;
+         memcpy(entries + size, part, n * sizeof(HTEntry64));
+         size += n;
+         free(part);
+      }
+   }
+   if (size > 0)
+      qsort(entries, size, sizeof(HTEntry64), snap_compare_entries);
+   for (i = 0; i < size; i++)
+      snapWrite(writer, entries[i].data, entries[i].frequency);
+   free(entries);
+   snapFinish(writer);
+}
+
+/*
+ * Heap of snapshot indexes, the one with the smallest current word first.
+ */
+static int snap_less(Snapshot **snaps, int a, int b)
+{
+   return compareWord(&snaps[a] -> word, &snaps[b] -> word) < 0;
+}
+
+static void snap_sift_down(Snapshot **snaps, int *heap, int size, int i)
+{
+   int top = heap[i], child;
+
+   while ((child = 2 * i + 1) < size)
+   {
+      if (child + 1 < size && snap_less(snaps, heap[child + 1], heap[child]))
+         child++;
+      if (!snap_less(snaps, heap[child], top))
+         break;
+      heap[i] = heap[child];
+      i = child;
+   }
+   heap[i] = top;
+}
+
+/*
+ * snapNext that also checks the records are in increasing order.
+ */
+static int snap_next_sorted(Snapshot *snap)
+{
+   Word previous = snap -> word;
+
+   if (!snapNext(snap))
+      return FALSE;
+   if (snap -> read > 1 && compareWord(&previous, &snap -> word) >= 0)
+      snap_fail(snap -> fname, "snapshot is not sorted");
+   return TRUE;
+}
+
+void snapMergeEach(Snapshot **snaps, int numSnaps, FNSnapVisit visit, \
+   void *context)
+{
+   int *heap = snap_alloc(numSnaps, sizeof(int)), size = 0, i;
+   uint64_t frequency;
+   Word word;
+
+   for (i = 0; i < numSnaps; i++)
+   {
+      if (!(snaps[i] -> flags & SNAP_SORTED))
+         snap_fail(snaps[i] -> fname, "snapshot is not sorted");
+      if (snap_next_sorted(snaps[i]))
+         heap[size++] = i;
+   }
+   for (i = size / 2 - 1; i >= 0; i--)
+      snap_sift_down(snaps, heap, size, i);
+   while (size > 0)
+   {
+      word = snaps[heap[0]] -> word;
+      frequency = 0;
+      do
+      {
+         frequency += snaps[heap[0]] -> frequency;
+         if (!snap_next_sorted(snaps[heap[0]]))
+            heap[0] = heap[--size];
+         snap_sift_down(snaps, heap, size, 0);
+      } while (size > 0 && compareWord(&snaps[heap[0]] -> word, &word) == 0);
+      visit(&word, frequency, context);
+   }
+   free(heap);
+}
+
+static void snap_write_visit(const Word *word, uint64_t frequency, \
+   void *context)
+{
+   snapWrite(context, word, frequency);
+}
+
+void snapMerge(Snapshot **snaps, int numSnaps, const char *fname)
+{
+   SnapWriter *writer = snapCreate(fname, SNAP_SORTED);
+
+   snapMergeEach(snaps, numSnaps, snap_write_visit, writer);
+   snapFinish(writer);
+}
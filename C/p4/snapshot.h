@@ -0,0 +1,117 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+ * On-disk word count snapshots, so that a count can be saved and later
+ * reloaded, added to and merged without re-tokenizing its input.
+ *
+ * Layout, all integers little-endian:
+ *
+ *    magic     6 bytes "WFSNAP"
+ *    version   1 byte, SNAP_VERSION
+ *    flags     1 byte, SNAP_SORTED when the records are in compareWord order
+ *    count     8 bytes, number of records
+ *    total     8 bytes, sum of the frequencies
+ *    records   count times: varint length, the bytes of the word, varint
+ *              frequency
+ *
+ * Varints are LEB128: 7 bits per byte, least significant group first, the
+ * high bit set on every byte but the last. Most words and frequencies fit
+ * in one byte each, so a record is usually the word plus 2 bytes.
+ *
+ * Snapshots are read through a read-only mapping and the Words handed out
+ * point into it, valid as long as the Snapshot is kept open. A table may keep
+ * them without copying the bytes (see borrowWord in main.c), but the chained
+ * HT_WORDS tables of the default hash copy every word into their nodes
+ * unless HT_BORROW (the -j shards), so loading into those costs one copy per
+ * unique word. Sorted snapshots can be
+ * merged in a single streaming pass (snapMerge) without building a hash
+ * table.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "getWord.h"
+
+#define SNAP_MAGIC "WFSNAP"
+#define SNAP_VERSION 1
+#define SNAP_HEADER_SIZE 24
+#define SNAP_SORTED 0x1
+
+typedef struct
+{
+   const char *fname;
+   Byte *map;
+   size_t length, pos;     /* pos: next record */
+   int flags;
+   uint64_t count, total;  /* from the header */
+   uint64_t read;          /* records returned so far */
+   Word word;              /* the last record read, points into map */
+   uint64_t frequency;
+} Snapshot;
+
+typedef struct
+{
+   const char *fname;
+   FILE *file;
+   int flags;
+   uint64_t count, total;
+} SnapWriter;
+
+/* Function type used by snapMergeEach: called once per merged word, which
+ * points into one of the snapshots and stays valid until it is closed.
+ */
+typedef void (*FNSnapVisit)(const Word *word, uint64_t frequency, \
+   void *context);
+
+/* Description: Maps fname and checks its header. Exits with a message when
+ *    the file cannot be read or is not a snapshot of this version.
+ */
+Snapshot* snapOpen(const char *fname);
+
+/* Description: Reads the next record into snap -> word and
+ *    snap -> frequency. The word stays valid until snapClose.
+ *
+ * Return: TRUE, or FALSE when every record has been read. Exits with a
+ *    message when the file is truncated or corrupt.
+ */
+int snapNext(Snapshot *snap);
+
+/* Description: Unmaps the snapshot and frees snap.
+ */
+void snapClose(Snapshot *snap);
+
+/* Description: Creates fname, truncating it, for records written with
+ *    snapWrite. flags is 0 or SNAP_SORTED, in which case the caller writes
+ *    the words in strictly increasing compareWord order.
+ */
+SnapWriter* snapCreate(const char *fname, int flags);
+
+void snapWrite(SnapWriter *writer, const Word *word, uint64_t frequency);
+
+/* Description: Writes the header and closes the file. Exits with a message
+ *    when anything could not be written.
+ */
+void snapFinish(SnapWriter *writer);
+
+/* Description: Writes every entry of numTables hash tables of Words, which
+ *    must not hold the same word twice (e.g. shards of one count), to fname.
+ *    With sorted the records are in compareWord order, which costs a sort
+ *    of an array of one HTEntry64 per word, otherwise in the order of the
+ *    tables.
+ */
+void snapDump(void **tables, int numTables, const char *fname, int sorted);
+
+/* Description: Streams the k-way merge of numSnaps SNAP_SORTED snapshots,
+ *    calling visit once per word in compareWord order with the sum of its
+ *    frequencies in all of them. Memory use is independent of the snapshot
+ *    sizes. Exits with a message when a snapshot is not sorted.
+ */
+void snapMergeEach(Snapshot **snaps, int numSnaps, FNSnapVisit visit, \
+   void *context);
+
+/* Description: snapMergeEach into the sorted snapshot fname.
+ */
+void snapMerge(Snapshot **snaps, int numSnaps, const char *fname);
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "getWord.h"
+#include "qsortHTEntriesExt.h"
+#include "sortHTEntries.h"
+
+#define SORT_INSERTION 16    /* blocks insertion sorted before merging */
+
+typedef struct
+{
+   unsigned long long key;   /* first 8 bytes of the word, big-endian */
+   HTEntry64 entry;
+} SortRecord;
+
+typedef struct
+{
+   SortRecord *src, *dst;
+   size_t begin, middle, end;
+} SortJob;
+
+static void* sort_alloc(size_t count, size_t size)
+{
+   void *ptr = malloc(count * size);
+
+   if (ptr == NULL && count > 0)
+   {
+      perror("sort");
+      exit(EXIT_FAILURE);
+   }
+   return ptr;
+}
+
+/*
+ * Missing bytes of short words are zero, so keys that differ order the words
+ * just like compareWord does.
+ */
+static unsigned long long sort_key(const Word *word)
+{
+   unsigned long long key = 0;
+   unsigned i, n = min(word -> length, 8);
+
+   for (i = 0; i < n; i++)
+      key |= (unsigned long long)word -> bytes[i] << (56 - 8 * i);
+   return key;
+}
+
+/*
+ * Frequencies of SORT_BUCKETS and more share bucket 0, the others are in
+ * descending order after it.
+ */
+static unsigned sort_bucket(uint64_t frequency)
+{
+   return frequency >= SORT_BUCKETS ? 0 : SORT_BUCKETS - frequency;
+}
+
+/*
+ * Same result as compareHTEntries on the two entries.
+ */
+static inline int sort_compare(const SortRecord *a, const SortRecord *b)
+{
+   if (a -> entry.frequency != b -> entry.frequency)
+      return a -> entry.frequency > b -> entry.frequency ? -1 : 1;
+   if (a -> key != b -> key)
+      return a -> key < b -> key ? -1 : 1;
+   return compareWord(a -> entry.data, b -> entry.data);
+}
+
+static void sort_insertion(SortRecord *records, size_t size)
+{
+   size_t i, j;
+   SortRecord record;
+
+   for (i = 1; i < size; i++)
+   {
+      record = records[i];
+      for (j = i; j > 0 && sort_compare(&record, &records[j - 1]) < 0; j--)
+         records[j] = records[j - 1];
+      records[j] = record;
+   }
+}
+
+/*
+ * Merges src[begin, middle) and src[middle, end) into dst[begin, end).
+ */
+static void sort_merge(const SortRecord *src, SortRecord *dst, size_t begin, \
+   size_t middle, size_t end)
+{
+   size_t i = begin, j = middle, k = begin;
+
+   while (i < middle && j < end)
+      dst[k++] = sort_compare(&src[j], &src[i]) < 0 ? src[j++] : src[i++];
+   memcpy(dst + k, src + i, (middle - i) * sizeof(SortRecord));
+   k += middle - i;
+   memcpy(dst + k, src + j, (end - j) * sizeof(SortRecord));
+}
+
+/*
+ * Bottom-up merge sort of records[0, size) with tmp as the second buffer.
+ */
+static void sort_run(SortRecord *records, SortRecord *tmp, size_t size)
+{
+   SortRecord *src = records, *dst = tmp, *swap;
+   size_t width, begin;
+
+   for (begin = 0; begin < size; begin += SORT_INSERTION)
+      sort_insertion(records + begin, min(SORT_INSERTION, size - begin));
+   for (width = SORT_INSERTION; width < size; width *= 2)
+   {
+      for (begin = 0; begin < size; begin += 2 * width)
+         sort_merge(src, dst, begin, min(begin + width, size), \
+            min(begin + 2 * width, size));
+      swap = src;
+      src = dst;
+      dst = swap;
+   }
+   if (src != records)
+      memcpy(records, src, size * sizeof(SortRecord));
+}
+
+static void* sort_piece_run(void *arg)
+{
+   SortJob *job = arg;
+
+   sort_run(job -> src + job -> begin, job -> dst + job -> begin, \
+      job -> end - job -> begin);
+   return NULL;
+}
+
+static void* sort_piece_merge(void *arg)
+{
+   SortJob *job = arg;
+
+   sort_merge(job -> src, job -> dst, job -> begin, job -> middle, job -> end);
+   return NULL;
+}
+
+/*
+ * Runs fn on every job, jobs[0] on the calling thread.
+ */
+static void sort_threads(SortJob *jobs, int count, void* (*fn)(void*))
+{
+   pthread_t *threads = sort_alloc(count, sizeof(pthread_t));
+   int i;
+
+   for (i = 1; i < count; i++)
+   {
+      if (pthread_create(&threads[i], NULL, fn, &jobs[i]) != 0)
+      {
+         perror("sort");
+         exit(EXIT_FAILURE);
+      }
+   }
+   fn(&jobs[0]);
+   for (i = 1; i < count; i++)
+      pthread_join(threads[i], NULL);
+   free(threads);
+}
+
+/*
+ * Sorts pieces equal slices of records in parallel, then merges neighbouring
+ * slices pairwise, each round in parallel, until one is left.
+ */
+static void sort_parallel(SortRecord *records, SortRecord *tmp, size_t size, \
+   int pieces)
+{
+   SortJob *jobs = sort_alloc(pieces, sizeof(SortJob));
+   size_t *bound = sort_alloc(pieces + 1, sizeof(size_t));
+   SortRecord *src = records, *dst = tmp, *swap;
+   int i, width, count;
+
+   for (i = 0; i <= pieces; i++)
+      bound[i] = size * i / pieces;
+   for (i = 0; i < pieces; i++)
+   {
+      jobs[i].src = records;
+      jobs[i].dst = tmp;
+      jobs[i].begin = bound[i];
+      jobs[i].end = bound[i + 1];
+   }
+   sort_threads(jobs, pieces, sort_piece_run);
+   for (width = 1; width < pieces; width *= 2)
+   {
+      for (i = 0, count = 0; i < pieces; i += 2 * width, count++)
+      {
+         jobs[count].src = src;
+         jobs[count].dst = dst;
+         jobs[count].begin = bound[i];
+         jobs[count].middle = bound[min(i + width, pieces)];
+         jobs[count].end = bound[min(i + 2 * width, pieces)];
+      }
+      sort_threads(jobs, count, sort_piece_merge);
+      swap = src;
+      src = dst;
+      dst = swap;
+   }
+   if (src != records)
+      memcpy(records, src, size * sizeof(SortRecord));
+   free(bound);
+   free(jobs);
+}
+
+void sortHTEntries(HTEntry64 *entries, uint64_t size, int threads)
+{
+   uint64_t start[SORT_BUCKETS + 2] = {0}, i, b, begin;
+   SortRecord *records, *tmp;
+
+   if (size < 2)
+      return;
+   for (i = 0; i < size; i++)
+      start[sort_bucket(entries[i].frequency) + 1]++;
+   for (b = 0; b <= SORT_BUCKETS; b++)
+      start[b + 1] += start[b];
+   records = sort_alloc(size, sizeof(SortRecord));
+   tmp = sort_alloc(size, sizeof(SortRecord));
+   for (i = 0; i < size; i++)
+   {
+      b = start[sort_bucket(entries[i].frequency)]++;
+      records[b].key = sort_key(entries[i].data);
+      records[b].entry = entries[i];
+   }
+   /* Bucket b now ends at start[b] */
+   for (b = 0, begin = 0; b <= SORT_BUCKETS; begin = start[b++])
+   {
+      if (threads > 1 && start[b] - begin >= SORT_PARALLEL_MIN)
+         sort_parallel(records + begin, tmp + begin, start[b] - begin, \
+            threads);
+      else if (start[b] - begin > 1)
+         sort_run(records + begin, tmp + begin, start[b] - begin);
+   }
+   for (i = 0; i < size; i++)
+      entries[i] = records[i].entry;
+   free(records);
+   free(tmp);
+}
@@ -0,0 +1,36 @@
+#ifndef SORTHTENTRIES_H
+#define SORTHTENTRIES_H
+/*
+ * A sort kernel for arrays of HTEntry64 whose data are Words, giving exactly
+ * the order of qsortHTEntries (compareHTEntries64, see qsortHTEntriesExt.h)
+ * without going through qsort and a compare function pointer.
+ *
+ * Entries are first distributed by a counting pass on frequency, which is
+ * heavily skewed towards small values, so that only entries of equal
+ * frequency remain to be compared. Each such run is merge sorted on records
+ * that carry the first 8 bytes of the word as a big-endian integer, so most
+ * compares are a single integer compare and compareWord is only needed when
+ * two words share those 8 bytes.
+ */
+#include "hashTable64.h"
+
+#ifndef SORT_BUCKETS
+#define SORT_BUCKETS 1024          /* frequencies with their own bucket */
+#endif
+#ifndef SORT_PARALLEL_MIN
+#define SORT_PARALLEL_MIN 65536    /* shortest run merge sorted in parallel */
+#endif
+
+/* Description: Sorts entries by descending frequency, ties broken by
+ *    ascending word order.
+ *
+ * Parameters:
+ *    entries: The entries, the data of which must point to Words.
+ *    size: The number of entries.
+ *    threads: Runs of at least SORT_PARALLEL_MIN entries are cut into this
+ *       many pieces that are sorted, and then merged pairwise, by as many
+ *       threads. 1 sorts everything on the calling thread.
+ */
+void sortHTEntries(HTEntry64 *entries, uint64_t size, int threads);
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+static void st_now(double *wall, double *cpu)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   *wall = ts.tv_sec + ts.tv_nsec * 1e-9;
+   /* All threads of the process, so -j shows its parallelism */
+   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+   *cpu = ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+Stats* statsCreate(void)
+{
+   Stats *stats = calloc(1, sizeof(Stats));
+
+   if (stats == NULL)
+   {
+      perror("wf");
+      exit(EXIT_FAILURE);
+   }
+   st_now(&stats -> wallMark, &stats -> cpuMark);
+   return stats;
+}
+
+void statsPhase(Stats *stats, const char *name)
+{
+   double wall, cpu;
+   int i;
+
+   if (stats == NULL)
+      return;
+   st_now(&wall, &cpu);
+   for (i = 0; i < stats -> numPhases && strcmp(stats -> names[i], name); i++)
+      ;
+   if (i == stats -> numPhases && i < ST_MAX_PHASES)
+      stats -> names[(stats -> numPhases)++] = name;
+   if (i < stats -> numPhases)
+   {
+      stats -> wall[i] += wall - stats -> wallMark;
+      stats -> cpu[i] += cpu - stats -> cpuMark;
+   }
+   stats -> wallMark = wall;
+   stats -> cpuMark = cpu;
+}
+
+void statsTables(Stats *stats, void **tables, int numTables)
+{
+   HTStats part;
+   int i, j;
+
+   for (i = 0; stats != NULL && i < numTables; i++)
+   {
+      part = htStats(tables[i]);
+      stats -> tables.rehashes += part.rehashes;
+      stats -> tables.probes += part.probes;
+      stats -> tables.compares += part.compares;
+      stats -> tables.allocated += part.allocated;
+      stats -> tables.bytes += part.bytes;
+      for (j = 0; j < HT_HISTOGRAM; j++)
+         stats -> tables.histogram[j] += part.histogram[j];
+      (stats -> numTables)++;
+   }
+}
+
+static void st_tables(FILE *file, HTStats *tables, int numTables)
+{
+   int i;
+
+   fprintf(file, "tables           %d\n", numTables);
+   fprintf(file, "rehashes         %" PRIu64 "\n", tables -> rehashes);
+   fprintf(file, "probes           %" PRIu64 "\n", tables -> probes);
+   fprintf(file, "compares         %" PRIu64 "\n", tables -> compares);
+   fprintf(file, "bytes allocated  %" PRIu64 "\n", tables -> allocated);
+   fprintf(file, "bytes held       %" PRIu64 "\n", tables -> bytes);
+   fprintf(file, "chain length     buckets (HT_OPEN: entries by probes)\n");
+   for (i = 0; i < HT_HISTOGRAM; i++)
+   {
+      fprintf(file, "%6d%-10s %" PRIu64 "\n", i, \
+         i == HT_HISTOGRAM - 1 ? "+" : "", tables -> histogram[i]);
+   }
+}
+
+void statsReport(Stats *stats, const char *fname)
+{
+   FILE *file = stderr;
+   struct rusage usage;
+   double wall = 0, cpu = 0;
+   int i;
+
+   if (stats == NULL)
+      return;
+   if (fname != NULL && (file = fopen(fname, "w")) == NULL)
+   {
+      fprintf(stderr, "wf: %s: ", fname);
+      perror("");
+      exit(EXIT_FAILURE);
+   }
+   fprintf(file, "phase            wall (s)     cpu (s)\n");
+   for (i = 0; i < stats -> numPhases; i++)
+   {
+      fprintf(file, "%-12s %12.6f %12.6f\n", stats -> names[i], \
+         stats -> wall[i], stats -> cpu[i]);
+      wall += stats -> wall[i];
+      cpu += stats -> cpu[i];
+   }
+   fprintf(file, "%-12s %12.6f %12.6f\n", "total", wall, cpu);
+   getrusage(RUSAGE_SELF, &usage);
+   fprintf(file, "peak rss (KiB)   %ld\n", usage.ru_maxrss);
+   if (stats -> numTables > 0)
+      st_tables(file, &stats -> tables, stats -> numTables);
+   if (file != stderr && fclose(file) != 0)
+   {
+      fprintf(stderr, "wf: %s: ", fname);
+      perror("");
+      exit(EXIT_FAILURE);
+   }
+   free(stats);
+}
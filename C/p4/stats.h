@@ -0,0 +1,44 @@
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * wf --stats: wall and CPU time of each phase of a run and the htStats of
+ * its hash tables, reported when the run ends. Every function does nothing
+ * when given a NULL Stats, so callers pass opts -> stats unconditionally.
+ */
+#include <stdint.h>
+#include "hashTable64.h"
+
+#define ST_MAX_PHASES 16
+
+typedef struct
+{
+   const char *names[ST_MAX_PHASES];
+   double wall[ST_MAX_PHASES], cpu[ST_MAX_PHASES];
+   int numPhases;
+   double wallMark, cpuMark;  /* when the current phase started */
+   HTStats tables;            /* summed over the tables reported */
+   int numTables;
+} Stats;
+
+/* Description: Creates a Stats whose first phase starts now. Exits with a
+ *    message when out of memory.
+ */
+Stats* statsCreate(void);
+
+/* Description: Ends the current phase, adding its times to those of name
+ *    (a string literal), and starts the next one.
+ */
+void statsPhase(Stats *stats, const char *name);
+
+/* Description: Adds the htStats of the tables, which should have been
+ *    created with htSetStats on.
+ */
+void statsTables(Stats *stats, void **tables, int numTables);
+
+/* Description: Writes the report to the file fname, or to stderr when it is
+ *    NULL, and frees stats.
+ */
+void statsReport(Stats *stats, const char *fname);
+
+#endif
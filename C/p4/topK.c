@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hashTableExt.h"
+#include "topK.h"
+
+static void* topk_alloc(size_t size)
+{
+   void *ptr = malloc(size);
+   if (ptr == NULL && size > 0)
+   {
+      perror("topK");
+      exit(EXIT_FAILURE);
+   }
+   return ptr;
+}
+
+TopK* topKCreate(unsigned k, FNCompareEntries compare)
+{
+   TopK *topK = topk_alloc(sizeof(TopK));
+
+   topK -> heap = topk_alloc(k * sizeof(HTEntry64));
+   topK -> size = 0;
+   topK -> k = k;
+   topK -> compare = compare;
+   return topK;
+}
+
+/*
+ * The heap is ordered so that every parent sorts after its children.
+ */
+static void topk_sift_up(TopK *topK, unsigned i)
+{
+   HTEntry64 entry = topK -> heap[i];
+   unsigned parent;
+
+   while (i > 0)
+   {
+      parent = (i - 1) / 2;
+      if (topK -> compare(&topK -> heap[parent], &entry) >= 0)
+         break;
+      topK -> heap[i] = topK -> heap[parent];
+      i = parent;
+   }
+   topK -> heap[i] = entry;
+}
+
+static void topk_sift_down(TopK *topK, unsigned i)
+{
+   HTEntry64 entry = topK -> heap[i], *heap = topK -> heap;
+   unsigned child;
+
+   while ((child = 2 * i + 1) < topK -> size)
+   {
+      if (child + 1 < topK -> size && \
+         topK -> compare(&heap[child + 1], &heap[child]) > 0)
+         child++;
+      if (topK -> compare(&heap[child], &entry) <= 0)
+         break;
+      heap[i] = heap[child];
+      i = child;
+   }
+   heap[i] = entry;
+}
+
+int topKAccepts(TopK *topK, const HTEntry64 *entry)
+{
+   return topK -> size < topK -> k || \
+      (topK -> k > 0 && topK -> compare(entry, &topK -> heap[0]) < 0);
+}
+
+void topKPush(TopK *topK, HTEntry64 entry)
+{
+   if (topK -> size < topK -> k)
+   {
+      topK -> heap[topK -> size] = entry;
+      topk_sift_up(topK, (topK -> size)++);
+   }
+   else if (topKAccepts(topK, &entry))
+   {
+      topK -> heap[0] = entry;
+      topk_sift_down(topK, 0);
+   }
+}
+
+HTEntry64* topKFinish(TopK *topK, uint64_t *size)
+{
+   HTEntry64 *entries = topK -> heap;
+
+   *size = topK -> size;
+   if (*size > 0)
+      qsort(entries, *size, sizeof(HTEntry64), topK -> compare);
+   else
+   {
+      free(entries);
+      entries = NULL;
+   }
+   free(topK);
+   return entries;
+}
+
+static void topk_visit(HTEntry64 entry, void *context)
+{
+   topKPush((TopK*)context, entry);
+}
+
+HTEntry64* topKTables(void **tables, int numTables, unsigned k, \
+   FNCompareEntries compare, FNSortEntries sort, void *context, \
+   uint64_t *size)
+{
+   int i;
+   uint64_t unique = 0, n;
+   HTEntry64 *entries, *part;
+   TopK *topK;
+
+   for (i = 0; i < numTables; i++)
+      unique += htUniqueEntries64(tables[i]);
+   if (k < unique)
+   {
+      topK = topKCreate(k, compare);
+      for (i = 0; i < numTables; i++)
+         htForEach64(tables[i], topk_visit, topK);
+      return topKFinish(topK, size);
+   }
+   *size = 0;
+   if (unique == 0)
+      return NULL;
+   entries = topk_alloc(unique * sizeof(HTEntry64));
+   for (i = 0; i < numTables; i++)
+   {
+      part = htToArray64(tables[i], &n);
+      if (n > 0)
+         memcpy(entries + *size, part, n * sizeof(HTEntry64));
+      *size += n;
+      free(part);
+   }
+   if (sort != NULL)
+      sort(entries, *size, context);
+   else
+      qsort(entries, *size, sizeof(HTEntry64), compare);
+   return entries;
+}
@@ -0,0 +1,62 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+/*
+ * Top-K selection of hash table entries. Instead of copying every entry into
+ * an array and sorting it, entries are streamed through a bounded heap that
+ * keeps the k entries that sort first, and only those k are sorted.
+ *
+ * compare is a qsort style compare function for HTEntry64, e.g.
+ * compareHTEntries64, and the result is in exactly the order qsort with the
+ * same function would give the first k entries.
+ */
+#include "hashTable64.h"
+
+typedef int (*FNCompareEntries)(const void *entry1, const void *entry2);
+
+/* Sorts size entries in the order of the FNCompareEntries it stands in for */
+typedef void (*FNSortEntries)(HTEntry64 *entries, uint64_t size, \
+   void *context);
+
+typedef struct
+{
+   HTEntry64 *heap;      /* heap[0] is the kept entry that sorts last */
+   unsigned size, k;
+   FNCompareEntries compare;
+} TopK;
+
+/* Description: Creates an empty selection of at most k entries.
+ */
+TopK* topKCreate(unsigned k, FNCompareEntries compare);
+
+/* Description: Returns whether topKPush would keep entry, so that callers
+ *    can defer making the entry's data permanent until it is kept.
+ */
+int topKAccepts(TopK *topK, const HTEntry64 *entry);
+
+/* Description: Offers one entry to the selection. O(log k) when the entry
+ *    is kept, a single compare otherwise.
+ */
+void topKPush(TopK *topK, HTEntry64 entry);
+
+/* Description: Frees topK and returns its entries sorted by compare.
+ *
+ * Return: A dynamically allocated array (NULL when empty) the caller frees,
+ *    size is set to its length.
+ */
+HTEntry64* topKFinish(TopK *topK, uint64_t *size);
+
+/* Description: Returns the first k entries, in sorted order, of all entries
+ *    of numTables hash tables taken together. The tables must not hold the
+ *    same data twice (e.g. shards of one count). When k covers every entry
+ *    this is htToArray64 followed by one sort, done by sort (called with
+ *    context) or, when sort is NULL, by qsort with compare.
+ *
+ * Return: A dynamically allocated array (NULL when empty) the caller frees,
+ *    size is set to its length.
+ */
+HTEntry64* topKTables(void **tables, int numTables, unsigned k, \
+   FNCompareEntries compare, FNSortEntries sort, void *context, \
+   uint64_t *size);
+
+#endif
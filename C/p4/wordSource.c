@@ -0,0 +1,605 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef WF_ZSTD
+#include <zstd.h>
+#endif
+#include "hashWord.h"
+#include "wordSource.h"
+
+#define TRUE 1
+#define FALSE 0
+
+static void ws_check(void *ptr)
+{
+   if (ptr == NULL)
+   {
+      perror("wf");
+      exit(EXIT_FAILURE);
+   }
+}
+
+/*
+ * Maps fd when it is a non-empty regular file. Returns FALSE when the caller
+ * has to fall back to reading blocks.
+ */
+static int ws_map(WordSource *ws)
+{
+   struct stat st;
+   void *map;
+
+   if (fstat(ws -> fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+      return FALSE;
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, ws -> fd, 0);
+   if (map == MAP_FAILED)
+      return FALSE;
+   if (wsCompressed(map, st.st_size))
+   {
+      munmap(map, st.st_size);
+      return FALSE;
+   }
+   madvise(map, st.st_size, MADV_SEQUENTIAL);
+   ws -> map = ws -> window = map;
+   ws -> mapLength = ws -> end = st.st_size;
+   ws -> eof = TRUE;
+   return TRUE;
+}
+
+/*
+ * Single-producer, single-consumer ring of WS_RING blocks. The reader
+ * thread fills blocks[filled % WS_RING] while fewer than WS_RING are ahead
+ * of released, the tokenizer reads blocks[released % WS_RING] until it
+ * releases it for the next. A length of 0 marks the end of the input.
+ *
+ * Compressed input is read into in, and decoded from in[inPos, inEnd) into
+ * the blocks.
+ */
+typedef struct wsReader
+{
+   pthread_t thread;
+   pthread_mutex_t lock;
+   pthread_cond_t more, room;
+   int fd;
+   Byte *blocks[WS_RING];
+   size_t lengths[WS_RING];
+   unsigned long filled, released;
+   int holding;         /* the tokenizer has blocks[released] */
+   int format;          /* of wsCompressed */
+   Byte *in;
+   size_t inPos, inEnd;
+   int frameEnd;        /* the last member or frame decoded is complete */
+   z_stream zlib;
+#ifdef WF_ZSTD
+   ZSTD_DCtx *zstd;
+#endif
+} WSReader;
+
+/*
+ * A gzip header is 10 bytes: the magic number, the method (8, deflate), a
+ * flags byte whose top 3 bits are reserved, then fields that any bytes
+ * make valid. libzstd checks a zstd frame header.
+ */
+int wsCompressed(const Byte *head, size_t length)
+{
+   if (length >= 10 && head[0] == 0x1F && head[1] == 0x8B && head[2] == 8 \
+      && (head[3] & 0xE0) == 0)
+      return WS_FORMAT_GZIP;
+#ifdef WF_ZSTD
+   if (length >= 4 && memcmp(head, "\x28\xB5\x2F\xFD", 4) == 0 && \
+      ZSTD_getFrameContentSize(head, length) != ZSTD_CONTENTSIZE_ERROR)
+      return WS_FORMAT_ZSTD;
+#endif
+   return 0;
+}
+
+static void ws_corrupt(const char *message)
+{
+   fprintf(stderr, "wf: compressed input: %s\n", message);
+   exit(EXIT_FAILURE);
+}
+
+/*
+ * Reads until the block is full or the input ends, so that a pipe's short
+ * reads still hand over whole blocks. Only cancelled inside read(), see
+ * ws_reader_close.
+ */
+static size_t ws_read_block(int fd, Byte *block)
+{
+   size_t length = 0;
+   ssize_t n = 1;
+
+   while (length < WS_BLOCK_SIZE && n != 0)
+   {
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      n = read(fd, block + length, WS_BLOCK_SIZE - length);
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+      if (n < 0 && errno != EINTR)
+      {
+         perror("wf");
+         exit(EXIT_FAILURE);
+      }
+      if (n > 0)
+         length += n;
+   }
+   return length;
+}
+
+/*
+ * One inflate call from in into out, starting the next gzip member when the
+ * last one is complete. Returns the bytes decoded.
+ */
+static size_t ws_inflate(WSReader *reader, Byte *out, size_t room)
+{
+   z_stream *zlib = &reader -> zlib;
+   int status;
+
+   if (reader -> frameEnd)
+      inflateReset(zlib);
+   zlib -> next_in = reader -> in + reader -> inPos;
+   zlib -> avail_in = reader -> inEnd - reader -> inPos;
+   zlib -> next_out = out;
+   zlib -> avail_out = room;
+   status = inflate(zlib, Z_NO_FLUSH);
+   if (status != Z_OK && status != Z_STREAM_END)
+      ws_corrupt(zlib -> msg != NULL ? zlib -> msg : "gzip error");
+   reader -> frameEnd = status == Z_STREAM_END;
+   reader -> inPos = reader -> inEnd - zlib -> avail_in;
+   return room - zlib -> avail_out;
+}
+
+#ifdef WF_ZSTD
+/*
+ * ws_inflate for zstd, whose context moves on to the next frame by itself.
+ */
+static size_t ws_unzstd(WSReader *reader, Byte *out, size_t room)
+{
+   ZSTD_inBuffer input = {reader -> in, reader -> inEnd, reader -> inPos};
+   ZSTD_outBuffer output = {out, room, 0};
+   size_t status = ZSTD_decompressStream(reader -> zstd, &output, &input);
+
+   if (ZSTD_isError(status))
+      ws_corrupt(ZSTD_getErrorName(status));
+   reader -> frameEnd = status == 0;
+   reader -> inPos = input.pos;
+   return output.pos;
+}
+#endif
+
+/*
+ * Decodes the next block, reading more input whenever in is used up.
+ * Returns the bytes decoded, 0 at the end of the input.
+ */
+static size_t ws_decode(WSReader *reader, Byte *block)
+{
+   size_t length = 0;
+
+   while (length < WS_BLOCK_SIZE)
+   {
+      if (reader -> inPos == reader -> inEnd)
+      {
+         reader -> inPos = 0;
+         reader -> inEnd = ws_read_block(reader -> fd, reader -> in);
+         if (reader -> inEnd == 0 && !reader -> frameEnd)
+            ws_corrupt("unexpected end of file");
+         if (reader -> inEnd == 0)
+            break;
+      }
+#ifdef WF_ZSTD
+      if (reader -> format == WS_FORMAT_ZSTD)
+      {
+         length += ws_unzstd(reader, block + length, WS_BLOCK_SIZE - length);
+         continue;
+      }
+#endif
+      length += ws_inflate(reader, block + length, WS_BLOCK_SIZE - length);
+   }
+   return length;
+}
+
+/*
+ * Reads the first block and looks for a magic number in it. Compressed, it
+ * becomes the first input of the decoder instead.
+ */
+static size_t ws_first_block(WSReader *reader, Byte *block)
+{
+   size_t length = ws_read_block(reader -> fd, block);
+
+   reader -> format = wsCompressed(block, length);
+   if (reader -> format == 0)
+      return length;
+   if (reader -> format == WS_FORMAT_GZIP && \
+      inflateInit2(&reader -> zlib, 16 + MAX_WBITS) != Z_OK)
+      ws_corrupt("cannot start gzip");
+#ifdef WF_ZSTD
+   if (reader -> format == WS_FORMAT_ZSTD && \
+      (reader -> zstd = ZSTD_createDCtx()) == NULL)
+      ws_corrupt("cannot start zstd");
+#endif
+   reader -> in = malloc(WS_BLOCK_SIZE);
+   ws_check(reader -> in);
+   memcpy(reader -> in, block, length);
+   reader -> inEnd = length;
+   return ws_decode(reader, block);
+}
+
+static void* ws_reader(void *arg)
+{
+   WSReader *reader = arg;
+   size_t length;
+   Byte *block;
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+   do
+   {
+      pthread_mutex_lock(&reader -> lock);
+      while (reader -> filled - reader -> released == WS_RING)
+         pthread_cond_wait(&reader -> room, &reader -> lock);
+      block = reader -> blocks[reader -> filled % WS_RING];
+      pthread_mutex_unlock(&reader -> lock);
+
+      if (reader -> filled == 0)
+         length = ws_first_block(reader, block);
+      else if (reader -> format == 0)
+         length = ws_read_block(reader -> fd, block);
+      else
+         length = ws_decode(reader, block);
+
+      pthread_mutex_lock(&reader -> lock);
+      reader -> lengths[reader -> filled % WS_RING] = length;
+      (reader -> filled)++;
+      pthread_cond_signal(&reader -> more);
+      pthread_mutex_unlock(&reader -> lock);
+   } while (length > 0);
+   return NULL;
+}
+
+static WSReader* ws_reader_open(int fd)
+{
+   WSReader *reader = calloc(1, sizeof(WSReader));
+   int i;
+
+   ws_check(reader);
+   reader -> fd = fd;
+   for (i = 0; i < WS_RING; i++)
+   {
+      /* Page aligned for the kernel's copies */
+      if ((errno = posix_memalign((void**)&reader -> blocks[i], 4096, \
+         WS_BLOCK_SIZE)))
+         ws_check(NULL);
+   }
+   posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+   pthread_mutex_init(&reader -> lock, NULL);
+   pthread_cond_init(&reader -> more, NULL);
+   pthread_cond_init(&reader -> room, NULL);
+   if ((errno = pthread_create(&reader -> thread, NULL, ws_reader, reader)))
+      ws_check(NULL);
+   return reader;
+}
+
+/*
+ * Stops the thread, which only waits in read() or for room once the
+ * tokenizer stops releasing blocks, and frees the ring.
+ */
+static void ws_reader_close(WSReader *reader)
+{
+   int i;
+
+   pthread_cancel(reader -> thread);
+   pthread_mutex_lock(&reader -> lock);
+   reader -> released = reader -> filled;
+   pthread_cond_signal(&reader -> room);
+   pthread_mutex_unlock(&reader -> lock);
+   pthread_join(reader -> thread, NULL);
+   pthread_mutex_destroy(&reader -> lock);
+   pthread_cond_destroy(&reader -> more);
+   pthread_cond_destroy(&reader -> room);
+   for (i = 0; i < WS_RING; i++)
+      free(reader -> blocks[i]);
+   if (reader -> format == WS_FORMAT_GZIP)
+      inflateEnd(&reader -> zlib);
+#ifdef WF_ZSTD
+   if (reader -> zstd != NULL)
+      ZSTD_freeDCtx(reader -> zstd);
+#endif
+   free(reader -> in);
+   free(reader);
+}
+
+/*
+ * Releases the block being tokenized and takes the next one from the
+ * reader. Returns FALSE, and sets eof, when nothing is left.
+ */
+static int ws_fill(WordSource *ws)
+{
+   WSReader *reader = ws -> reader;
+   size_t n;
+
+   if (ws -> eof)
+      return FALSE;
+   pthread_mutex_lock(&reader -> lock);
+   if (reader -> holding)
+   {
+      (reader -> released)++;
+      pthread_cond_signal(&reader -> room);
+   }
+   while (reader -> filled == reader -> released)
+      pthread_cond_wait(&reader -> more, &reader -> lock);
+   reader -> holding = TRUE;
+   n = reader -> lengths[reader -> released % WS_RING];
+   ws -> block = ws -> window = reader -> blocks[reader -> released % WS_RING];
+   pthread_mutex_unlock(&reader -> lock);
+   ws -> pos = 0;
+   ws -> end = n;
+   ws -> maskCount = 0;
+   if (n == 0)
+      ws -> eof = TRUE;
+   return n > 0;
+}
+
+WordSource* wsOpenFd(int fd)
+{
+   WordSource *ws = calloc(1, sizeof(WordSource));
+
+   ws_check(ws);
+   ws -> fd = fd;
+   ws -> kernel = wsKernel();
+   ws -> scratchSize = WS_SCRATCH_SIZE;
+   ws -> scratch = malloc(ws -> scratchSize);
+   ws_check(ws -> scratch);
+   if (!ws_map(ws))
+   {
+      ws -> reader = ws_reader_open(fd);
+      ws -> block = ws -> window = ws -> reader -> blocks[0];
+   }
+   return ws;
+}
+
+WordSource* wsOpenRange(const Byte *map, size_t begin, size_t end)
+{
+   WordSource *ws = calloc(1, sizeof(WordSource));
+
+   ws_check(ws);
+   ws -> fd = -1;
+   ws -> kernel = wsKernel();
+   ws -> scratchSize = WS_SCRATCH_SIZE;
+   ws -> scratch = malloc(ws -> scratchSize);
+   ws_check(ws -> scratch);
+   ws -> window = (Byte*)map;
+   ws -> pos = begin;
+   ws -> end = end;
+   ws -> eof = TRUE;
+   return ws;
+}
+
+size_t wsAlignRange(const Byte *map, size_t length, size_t offset)
+{
+   while (offset > 0 && offset < length && !isspace(map[offset - 1]))
+      offset++;
+   return offset;
+}
+
+/*
+ * Makes the masks cover pos, classifying the bytes from pos on if they do not.
+ * Returns the offset of pos in the masks.
+ */
+static unsigned ws_classify(WordSource *ws, size_t pos)
+{
+   if (pos - ws -> maskBase >= ws -> maskCount)
+   {
+      ws -> maskBase = pos;
+      ws -> maskCount = min(ws -> end - pos, WS_MASK_BYTES);
+      ws -> kernel -> classify(ws -> window + pos, ws -> maskCount, \
+         &ws -> masks);
+   }
+   return pos - ws -> maskBase;
+}
+
+static int ws_skip_space(WordSource *ws)
+{
+   unsigned shift;
+   unsigned long long word, valid;
+
+   for (;;)
+   {
+      while (ws -> pos < ws -> end)
+      {
+         shift = ws_classify(ws, ws -> pos);
+         valid = ws -> maskCount < WS_MASK_BYTES ? \
+            (1ULL << ws -> maskCount) - 1 : ~0ULL;
+         word = (~ws -> masks.space & valid) >> shift;
+         if (word != 0)
+         {
+            ws -> pos += __builtin_ctzll(word);
+            return TRUE;
+         }
+         ws -> pos = ws -> maskBase + ws -> maskCount;
+      }
+      if (!ws_fill(ws))
+         return FALSE;
+   }
+}
+
+/*
+ * Returns the end of the word starting at start, which is either the index of
+ * the next whitespace byte or the end of the window.
+ */
+static size_t ws_scan(WordSource *ws, size_t start, int *printable, int *upper)
+{
+   unsigned shift;
+   unsigned long long space, before;
+
+   while (start < ws -> end)
+   {
+      shift = ws_classify(ws, start);
+      space = ws -> masks.space >> shift;
+      before = space != 0 ? (1ULL << __builtin_ctzll(space)) - 1 : ~0ULL;
+      if ((ws -> masks.print >> shift) & before)
+         *printable = TRUE;
+      if ((ws -> masks.upper >> shift) & before)
+         *upper = TRUE;
+      if (space != 0)
+         return start + __builtin_ctzll(space);
+      start = ws -> maskBase + ws -> maskCount;
+   }
+   return start;
+}
+
+static void ws_reserve(WordSource *ws, size_t size)
+{
+   while (size > ws -> scratchSize)
+   {
+      ws -> scratchSize *= 2;
+      ws -> scratch = realloc(ws -> scratch, ws -> scratchSize);
+      ws_check(ws -> scratch);
+   }
+}
+
+static void ws_append(WordSource *ws, unsigned *length, const Byte *bytes, \
+   size_t count)
+{
+   ws_reserve(ws, *length + count);
+   ws -> kernel -> lower(ws -> scratch + *length, bytes, count);
+   *length += count;
+}
+
+/*
+ * Lowercases the ASCII letters of 8 bytes: a byte below 0x80 is in 'A' to
+ * 'Z' when adding 0x3F sets its high bit and adding 0x25 does not, which
+ * cannot carry into the next byte once the high bits are cleared.
+ */
+static unsigned long long ws_lower8(unsigned long long x)
+{
+   unsigned long long low = x & 0x7F7F7F7F7F7F7F7FULL;
+   unsigned long long upper = (low + 0x3F3F3F3F3F3F3F3FULL) & \
+      ~(low + 0x2525252525252525ULL) & ~x & 0x8080808080808080ULL;
+
+   return x | upper >> 2;
+}
+
+/*
+ * The kernel's lower fused with hashWordBytes: each 8 bytes are lowercased
+ * in a register, stored to dst (which may be src) and hashed. Returns the
+ * hash of the lowercased bytes.
+ */
+static unsigned long long ws_lower_hash(Byte *dst, const Byte *src, \
+   unsigned count)
+{
+   unsigned long long h = hw_start(count), block;
+   unsigned i;
+
+   for (i = 0; i + 8 <= count; i += 8)
+   {
+      memcpy(&block, src + i, 8);
+      block = ws_lower8(block);
+      memcpy(dst + i, &block, 8);
+      h = hw_block(h, block);
+   }
+   for (block = 0; i < count; i++)
+   {
+      dst[i] = tolower(src[i]);
+      block = (block << 8) | dst[i];
+   }
+   return hw_finish(h, block);
+}
+
+/*
+ * Assembles a word that runs off the end of the current block in scratch.
+ */
+static unsigned ws_straddle(WordSource *ws, size_t start, size_t stop, \
+   int *printable)
+{
+   unsigned length = 0;
+   int upper;
+
+   for (;;)
+   {
+      ws_append(ws, &length, ws -> window + start, stop - start);
+      ws -> pos = stop;
+      if (stop < ws -> end || !ws_fill(ws))
+         return length;
+      start = 0;
+      stop = ws_scan(ws, start, printable, &upper);
+   }
+}
+
+/*
+ * wsNextWord, and wsNextHashed when hash is not NULL.
+ */
+static int ws_next(WordSource *ws, Byte **word, unsigned *wordLength, \
+   int *hasPrintable, unsigned long long *hash)
+{
+   size_t start, stop;
+   int printable = FALSE, upper = FALSE;
+   Byte *lowered;
+
+   if (!ws_skip_space(ws))
+      return EOF;
+   start = ws -> pos;
+   stop = ws_scan(ws, start, &printable, &upper);
+   if (stop == ws -> end && !ws -> eof)
+   {
+      *wordLength = ws_straddle(ws, start, stop, &printable);
+      *word = ws -> scratch;
+      if (hash != NULL)
+         *hash = hashWordBytes(*word, *wordLength);
+   }
+   else if (upper)
+   {
+      /* A mapping is read-only, a block is lowercased in place */
+      lowered = ws -> window + start;
+      if (ws -> block == NULL)
+      {
+         ws_reserve(ws, stop - start);
+         lowered = ws -> scratch;
+      }
+      if (hash != NULL)
+         *hash = ws_lower_hash(lowered, ws -> window + start, stop - start);
+      else
+         ws -> kernel -> lower(lowered, ws -> window + start, stop - start);
+      ws -> pos = stop;
+      *wordLength = stop - start;
+      *word = lowered;
+   }
+   else
+   {
+      ws -> pos = stop;
+      *wordLength = stop - start;
+      *word = ws -> window + start;
+      if (hash != NULL)
+         *hash = hashWordBytes(*word, *wordLength);
+   }
+   *hasPrintable = printable;
+   return 0;
+}
+
+int wsNextWord(WordSource *ws, Byte **word, unsigned *wordLength, \
+   int *hasPrintable)
+{
+   return ws_next(ws, word, wordLength, hasPrintable, NULL);
+}
+
+int wsNextHashed(WordSource *ws, Byte **word, unsigned *wordLength, \
+   int *hasPrintable, unsigned long long *hash)
+{
+   return ws_next(ws, word, wordLength, hasPrintable, hash);
+}
+
+void wsClose(WordSource *ws)
+{
+   if (ws -> map != NULL)
+      munmap(ws -> map, ws -> mapLength);
+   if (ws -> reader != NULL)
+      ws_reader_close(ws -> reader);
+   free(ws -> scratch);
+   if (ws -> fd >= 0)
+      close(ws -> fd);
+   free(ws);
+}
@@ -0,0 +1,119 @@
+#ifndef WORDSOURCE_H
+#define WORDSOURCE_H
+
+/*
+ * Zero-copy word reader for the Word Frequency project.
+ *
+ * Bytes are classified WS_MASK_BYTES at a time into bit masks, by a
+ * vectorized kernel when the CPU has one (see wordSourceSimd.h), and word
+ * boundaries are found with bit scans rather than a ctype.h call per byte.
+ *
+ * Regular files are mmap'ed and tokenized in place: the returned "word" is a
+ * slice of the mapping whenever it is already lowercase, so nothing is copied
+ * until the caller decides to keep it. Words containing uppercase letters are
+ * lowercased into a scratch buffer owned by the WordSource.
+ *
+ * stdin, pipes and anything else that cannot be mapped are read with read()
+ * in WS_BLOCK_SIZE blocks by a reader thread, which fills up to WS_RING
+ * blocks ahead of the tokenizer so reading and counting overlap. Words are
+ * lowercased in place in the block and words that straddle two blocks are
+ * assembled in the scratch buffer.
+ *
+ * Input compressed with gzip, or zstd when built with WF_ZSTD, is recognized
+ * by its magic number, never mapped, and decompressed by the reader thread
+ * straight into the blocks. Concatenated members or frames are all read.
+ *
+ * Words follow the getWord definition: one or more contiguous non-whitespace
+ * byte-values (C locale isspace) delineated by whitespace, converted to
+ * lowercase, and not nul-terminated.
+ */
+#include <stddef.h>
+#include "getWord.h"
+#include "wordSourceSimd.h"
+
+#ifndef WS_BLOCK_SIZE
+#define WS_BLOCK_SIZE (1 << 20)
+#endif
+#define WS_SCRATCH_SIZE 64
+/* Blocks read ahead, including the one being tokenized */
+#define WS_RING 4
+
+/* Formats of wsCompressed */
+#define WS_FORMAT_GZIP 1
+#define WS_FORMAT_ZSTD 2
+/* Bytes wsCompressed needs to recognize any header (zstd's longest) */
+#define WS_HEAD_SIZE 18
+
+typedef struct
+{
+   int fd;              /* -1 for wsOpenRange */
+   Byte *map;           /* owned file mapping, else NULL */
+   size_t mapLength;
+   struct wsReader *reader; /* reads the blocks when not mapped */
+   Byte *block;         /* the reader's block being tokenized */
+   Byte *window;        /* a read-only mapping or block */
+   size_t pos, end;     /* unscanned part of window */
+   int eof;             /* no more data beyond window */
+   Byte *scratch;       /* lowercased or block-straddling words */
+   unsigned scratchSize;
+   const WSKernel *kernel;
+   WSMasks masks;       /* classify window[maskBase, maskBase + maskCount) */
+   size_t maskBase, maskCount;
+} WordSource;
+
+/* Description: Creates a WordSource reading from an open file descriptor. The
+ *    descriptor is mapped when it refers to a non-empty regular file,
+ *    otherwise it is read in blocks. The WordSource takes ownership of fd.
+ *
+ * Return: A dynamically allocated WordSource, free it with wsClose.
+ */
+WordSource* wsOpenFd(int fd);
+
+/* Description: Creates a WordSource over bytes [begin, end) of a mapping
+ *    owned by the caller, which must outlive the WordSource. begin and end
+ *    should fall on whitespace or the ends of the mapping so no word is cut.
+ *
+ * Return: A dynamically allocated WordSource, free it with wsClose.
+ */
+WordSource* wsOpenRange(const Byte *map, size_t begin, size_t end);
+
+/* Description: Returns the compressed format whose header length bytes at
+ *    head start with, WS_FORMAT_GZIP or WS_FORMAT_ZSTD (only when built with
+ *    WF_ZSTD), else 0. A magic number followed by an invalid header, or
+ *    zstd without WF_ZSTD, is 0: such input is counted as plain text.
+ */
+int wsCompressed(const Byte *head, size_t length);
+
+/* Description: Moves offset forward, if necessary, to the first byte that
+ *    does not continue a word started before it, i.e. the start of the
+ *    mapping or a byte preceded by whitespace. Used to split a mapping into
+ *    ranges for wsOpenRange.
+ */
+size_t wsAlignRange(const Byte *map, size_t length, size_t offset);
+
+/* Description: Reads the next word from the source.
+ *
+ * Notes:
+ *    1. The returned bytes belong to the WordSource and are only valid until
+ *       the next call to wsNextWord or wsClose. Copy them to keep them.
+ *    2. Unlike getWord, a word is never returned together with EOF; EOF means
+ *       there are no more words and the output parameters are unchanged.
+ *
+ * Return: 0 when a word of one or more bytes was returned, otherwise EOF.
+ */
+int wsNextWord(WordSource *ws, Byte **word, unsigned *wordLength, \
+   int *hasPrintable);
+
+/* Description: wsNextWord that also sets hash to hashWord64 of the word
+ *    (see hashWord.h), computed while the word is found: words with
+ *    uppercase letters are hashed in the same pass that lowercases them,
+ *    others while their bytes are still in cache. For htInternHashed64.
+ */
+int wsNextHashed(WordSource *ws, Byte **word, unsigned *wordLength, \
+   int *hasPrintable, unsigned long long *hash);
+
+/* Description: Unmaps/frees everything owned by the source and closes fd.
+ */
+void wsClose(WordSource *ws);
+
+#endif
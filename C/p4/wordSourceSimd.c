@@ -0,0 +1,176 @@
+#include <ctype.h>
+#include "wordSourceSimd.h"
+
+#if WS_SIMD > 0 && defined(__x86_64__)
+#define WS_X86
+#endif
+
+/*
+ * Classifies bytes [from, count) into bits [from, count) of masks.
+ */
+static void scalar_tail(const Byte *bytes, size_t from, size_t count, \
+   WSMasks *masks)
+{
+   unsigned long long bit;
+
+   for (; from < count; from++)
+   {
+      bit = 1ULL << from;
+      if (isspace(bytes[from]))
+         masks -> space |= bit;
+      if (isprint(bytes[from]))
+         masks -> print |= bit;
+      if (isupper(bytes[from]))
+         masks -> upper |= bit;
+   }
+}
+
+static void scalar_lower(Byte *dst, const Byte *src, size_t count)
+{
+   size_t i;
+
+   for (i = 0; i < count; i++)
+      dst[i] = tolower(src[i]);
+}
+
+#ifndef WS_X86
+static void scalar_classify(const Byte *bytes, size_t count, WSMasks *masks)
+{
+   masks -> space = masks -> print = masks -> upper = 0;
+   scalar_tail(bytes, 0, count, masks);
+}
+
+static const WSKernel scalarKernel = {
+   scalar_classify, scalar_lower, "scalar"
+};
+#else
+#include <immintrin.h>
+
+/* ' ' or '\t' to '\r', the latter as an unsigned (v - 9) <= 4 */
+static inline __m128i sse2_space(__m128i v)
+{
+   __m128i ctl = _mm_sub_epi8(v, _mm_set1_epi8(9));
+
+   return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), \
+      _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8(4)), ctl));
+}
+
+/* Signed compares: bytes of 0x80 and up are negative, so never in range */
+static inline __m128i sse2_range(__m128i v, char low, char high)
+{
+   return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(low - 1)), \
+      _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), v));
+}
+
+static void sse2_classify(const Byte *bytes, size_t count, WSMasks *masks)
+{
+   __m128i v;
+   size_t i;
+
+   masks -> space = masks -> print = masks -> upper = 0;
+   for (i = 0; i + 16 <= count; i += 16)
+   {
+      v = _mm_loadu_si128((const __m128i*)(bytes + i));
+      masks -> space |= (unsigned long long) \
+         (unsigned)_mm_movemask_epi8(sse2_space(v)) << i;
+      masks -> print |= (unsigned long long) \
+         (unsigned)_mm_movemask_epi8(sse2_range(v, ' ', '~')) << i;
+      masks -> upper |= (unsigned long long) \
+         (unsigned)_mm_movemask_epi8(sse2_range(v, 'A', 'Z')) << i;
+   }
+   scalar_tail(bytes, i, count, masks);
+}
+
+static void sse2_lower(Byte *dst, const Byte *src, size_t count)
+{
+   __m128i v;
+   size_t i;
+
+   for (i = 0; i + 16 <= count; i += 16)
+   {
+      v = _mm_loadu_si128((const __m128i*)(src + i));
+      v = _mm_add_epi8(v, _mm_and_si128(sse2_range(v, 'A', 'Z'), \
+         _mm_set1_epi8(0x20)));
+      _mm_storeu_si128((__m128i*)(dst + i), v);
+   }
+   scalar_lower(dst + i, src + i, count - i);
+}
+
+static const WSKernel sse2Kernel = {
+   sse2_classify, sse2_lower, "sse2"
+};
+
+#if WS_SIMD > 1
+#define AVX2 __attribute__((target("avx2")))
+
+static inline AVX2 __m256i avx2_space(__m256i v)
+{
+   __m256i ctl = _mm256_sub_epi8(v, _mm256_set1_epi8(9));
+
+   return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), \
+      _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, _mm256_set1_epi8(4)), ctl));
+}
+
+static inline AVX2 __m256i avx2_range(__m256i v, char low, char high)
+{
+   return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(low - 1)), \
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), v));
+}
+
+static AVX2 void avx2_classify(const Byte *bytes, size_t count, \
+   WSMasks *masks)
+{
+   __m256i v;
+   size_t i;
+
+   if (count < WS_MASK_BYTES)
+   {
+      sse2_classify(bytes, count, masks);
+      return;
+   }
+   masks -> space = masks -> print = masks -> upper = 0;
+   for (i = 0; i < WS_MASK_BYTES; i += 32)
+   {
+      v = _mm256_loadu_si256((const __m256i*)(bytes + i));
+      masks -> space |= (unsigned long long) \
+         (unsigned)_mm256_movemask_epi8(avx2_space(v)) << i;
+      masks -> print |= (unsigned long long) \
+         (unsigned)_mm256_movemask_epi8(avx2_range(v, ' ', '~')) << i;
+      masks -> upper |= (unsigned long long) \
+         (unsigned)_mm256_movemask_epi8(avx2_range(v, 'A', 'Z')) << i;
+   }
+}
+
+static AVX2 void avx2_lower(Byte *dst, const Byte *src, size_t count)
+{
+   __m256i v;
+   size_t i;
+
+   for (i = 0; i + 32 <= count; i += 32)
+   {
+      v = _mm256_loadu_si256((const __m256i*)(src + i));
+      v = _mm256_add_epi8(v, _mm256_and_si256(avx2_range(v, 'A', 'Z'), \
+         _mm256_set1_epi8(0x20)));
+      _mm256_storeu_si256((__m256i*)(dst + i), v);
+   }
+   sse2_lower(dst + i, src + i, count - i);
+}
+
+static const WSKernel avx2Kernel = {
+   avx2_classify, avx2_lower, "avx2"
+};
+#endif
+#endif
+
+const WSKernel* wsKernel(void)
+{
+#ifdef WS_X86
+#if WS_SIMD > 1
+   if (__builtin_cpu_supports("avx2"))
+      return &avx2Kernel;
+#endif
+   return &sse2Kernel;
+#else
+   return &scalarKernel;
+#endif
+}
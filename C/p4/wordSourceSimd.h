@@ -0,0 +1,44 @@
+#ifndef WORDSOURCESIMD_H
+#define WORDSOURCESIMD_H
+
+/*
+ * Byte classification kernels behind the WordSource tokenizer.
+ *
+ * A kernel classifies up to 64 bytes at a time into whitespace, printable and
+ * uppercase bit masks, which the tokenizer then walks with bit scans, and
+ * lowercases runs of bytes. The SSE2 and AVX2 kernels do both 16 or 32 bytes
+ * per instruction. They hard-code the C locale (wf never calls setlocale):
+ * whitespace is ' ' and '\t' through '\r', printable is ' ' through '~', and
+ * every other byte, binary data included, is a word byte kept as is. The
+ * scalar kernel uses ctype.h and handles the tails shorter than a vector.
+ *
+ * WS_SIMD limits the kernels wsKernel may pick: 0 scalar only, 1 up to SSE2,
+ * 2 (default) up to AVX2 when the CPU supports it.
+ */
+#include <stddef.h>
+#include "getWord.h"
+
+#ifndef WS_SIMD
+#define WS_SIMD 2
+#endif
+#define WS_MASK_BYTES 64
+
+typedef struct
+{
+   unsigned long long space, print, upper;    /* bit i is byte i */
+} WSMasks;
+
+typedef struct
+{
+   /* Classifies count (at most WS_MASK_BYTES) bytes, higher bits are 0 */
+   void (*classify)(const Byte *bytes, size_t count, WSMasks *masks);
+   /* Copies count lowercased bytes, dst may be src */
+   void (*lower)(Byte *dst, const Byte *src, size_t count);
+   const char *name;
+} WSKernel;
+
+/* Description: Returns the best kernel for the running CPU.
+ */
+const WSKernel* wsKernel(void);
+
+#endif